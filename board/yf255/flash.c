@@ -49,13 +49,23 @@ flash_info_t flash_info[CFG_MAX_FLASH_BANKS];	/* info for FLASH chips    */
 
 #define mb() __asm__ __volatile__ ("" : : : "memory")
 
+#ifdef CFG_FLASH_USE_BUFFER_WRITE
+/* StrataFlash write buffer: 32 bytes per x16 chip, chips side by side */
+#define WBUF_SIZE	(32 * sizeof (FPW) / 2)
+#endif
+
+/* show a percentage for writes of at least this size */
+#define PROGRESS_MIN	PHYS_FLASH_SECT_SIZE
+
 /*-----------------------------------------------------------------------
  * Functions
  */
 static ulong flash_get_size (FPW *addr, flash_info_t *info);
 static int write_data (flash_info_t *info, ulong dest, FPW data);
+#ifdef CFG_FLASH_USE_BUFFER_WRITE
+static int write_buffer (flash_info_t *info, ulong dest, uchar *src, int cnt);
+#endif
 static void flash_get_offsets (ulong base, flash_info_t *info);
-void inline spin_wheel (void);
 
 /*-----------------------------------------------------------------------
  */
@@ -272,15 +282,16 @@ int flash_erase (flash_info_t *info, int s_first, int s_last)
 
 			printf ("Erasing sector %2d ... ", sect);
 
-			/* arm simple, non interrupt dependent timer */
-			reset_timer_masked ();
+			/* simple, non interrupt dependent timer; not reset,
+			 * so running network timeouts are not disturbed */
+			start = get_timer_masked ();
 
 			*addr = (FPW) 0x00500050;	/* clear status register */
 			*addr = (FPW) 0x00200020;	/* erase setup */
 			*addr = (FPW) 0x00D000D0;	/* erase confirm */
 
 			while (((status = *addr) & (FPW) 0x00800080) != (FPW) 0x00800080) {
-				if (get_timer_masked () > CFG_FLASH_ERASE_TOUT) {
+				if (get_timer_masked () - start > CFG_FLASH_ERASE_TOUT) {
 					printf ("Timeout\n");
 					*addr = (FPW) 0x00B000B0;	/* suspend erase     */
 					*addr = (FPW) 0x00FF00FF;	/* reset to read mode */
@@ -298,19 +309,93 @@ int flash_erase (flash_info_t *info, int s_first, int s_last)
 	return rcode;
 }
 
+#ifdef CFG_FLASH_ASYNC_ERASE
+/*-----------------------------------------------------------------------
+ * Erase a single sector without waiting for completion, so the caller
+ * can do other work (e.g. receive the data for it) meanwhile.  Only
+ * one erase may be in progress; the sector must be polled with
+ * flash_erase_poll() until it is done before the flash is used again.
+ */
+static ulong erase_start;
+
+int flash_erase_start (flash_info_t *info, int sect)
+{
+	FPWV *addr;
+
+	if ((info->flash_id & FLASH_VENDMASK) != FLASH_MAN_INTEL)
+		return ERR_UNKNOWN_FLASH_VENDOR;
+	if (info->protect[sect])
+		return ERR_PROTECTED;
+
+	addr = (FPWV *) (info->start[sect]);
+	erase_start = get_timer_masked ();
+
+	*addr = (FPW) 0x00500050;	/* clear status register */
+	*addr = (FPW) 0x00200020;	/* erase setup */
+	*addr = (FPW) 0x00D000D0;	/* erase confirm */
+
+	return ERR_OK;
+}
+
+/*
+ * Returns 1 while the erase is still running, 0 once it completed
+ * (flash back in read mode), or an ERR_xxx code.
+ */
+int flash_erase_poll (flash_info_t *info, int sect)
+{
+	FPWV *addr = (FPWV *) (info->start[sect]);
+	FPW status = *addr;
+	int rc = ERR_OK;
+
+	if ((status & (FPW) 0x00800080) != (FPW) 0x00800080) {
+		if (get_timer_masked () - erase_start <= CFG_FLASH_ERASE_TOUT)
+			return 1;
+		*addr = (FPW) 0x00B000B0;	/* suspend erase     */
+		rc = ERR_TIMOUT;
+	} else if (status & (FPW) 0x00200020) {
+		rc = ERR_PROG_ERROR;		/* erase failed		*/
+	}
+
+	*addr = (FPW) 0x00500050;	/* clear status register cmd.   */
+	*addr = (FPW) 0x00FF00FF;	/* reset to read mode          */
+
+	return rc;
+}
+#endif /* CFG_FLASH_ASYNC_ERASE */
+
+/*-----------------------------------------------------------------------
+ * Fetch one flash word from a source buffer, byte order as in memory
+ * (little endian: same as assembling it big endian and swapping).
+ */
+static inline FPW get_data (uchar *src)
+{
+	FPW data;
+	int i;
+
+	if (((ulong) src & (sizeof (FPW) - 1)) == 0)
+		return *(FPW *) src;
+
+	data = 0;
+	for (i = 0; i < sizeof (FPW); ++i) {
+		data = (data << 8) | *src++;
+	}
+	return SWAP (data);
+}
+
 /*-----------------------------------------------------------------------
  * Copy memory to flash, returns:
  * 0 - OK
  * 1 - write timeout
  * 2 - Flash not erased
  * 4 - Flash not identified
+ * 128 - programming error
  */
 
 int write_buff (flash_info_t *info, uchar *src, ulong addr, ulong cnt)
 {
-	ulong cp, wp;
+	ulong cp, wp, total, next;
 	FPW data;
-	int count, i, l, rc, port_width;
+	int i, l, rc, port_width;
 
 	if (info->flash_id == FLASH_UNKNOWN) {
 		return 4;
@@ -350,22 +435,35 @@ int write_buff (flash_info_t *info, uchar *src, ulong addr, ulong cnt)
 	/*
 	 * handle word aligned part
 	 */
-	count = 0;
+	total = cnt;
+	next = 0;
+	if (total >= PROGRESS_MIN)
+		puts ("  0%");
 	while (cnt >= port_width) {
-		data = 0;
-		for (i = 0; i < port_width; ++i) {
-			data = (data << 8) | *src++;
+#ifdef CFG_FLASH_USE_BUFFER_WRITE
+		/* fill up to the end of the current write buffer */
+		l = WBUF_SIZE - (wp & (WBUF_SIZE - 1));
+		if (l > cnt)
+			l = cnt & ~(port_width - 1);
+		if ((rc = write_buffer (info, wp, src, l)) != 0) {
+			return (rc);
 		}
-		if ((rc = write_data (info, wp, SWAP (data))) != 0) {
+#else
+		l = port_width;
+		if ((rc = write_data (info, wp, get_data (src))) != 0) {
 			return (rc);
 		}
-		wp += port_width;
-		cnt -= port_width;
-		if (count++ > 0x800) {
-			spin_wheel ();
-			count = 0;
+#endif
+		wp += l;
+		src += l;
+		cnt -= l;
+		if (total >= PROGRESS_MIN && total - cnt >= next) {
+			printf ("\b\b\b\b%3ld%%", (total - cnt) / (total / 100));
+			next += PROGRESS_MIN / 4;
 		}
 	}
+	if (total >= PROGRESS_MIN)
+		puts ("\b\b\b\b    \b\b\b\b");
 
 	if (cnt == 0) {
 		return (0);
@@ -386,6 +484,71 @@ int write_buff (flash_info_t *info, uchar *src, ulong addr, ulong cnt)
 	return (write_data (info, wp, SWAP (data)));
 }
 
+#ifdef CFG_FLASH_USE_BUFFER_WRITE
+/*-----------------------------------------------------------------------
+ * Program whole words with the write to buffer command; the range
+ * must not cross a write buffer boundary.  Returns:
+ * 0 - OK
+ * 1 - write timeout
+ * 2 - Flash not erased
+ * 128 - programming error
+ */
+static int write_buffer (flash_info_t *info, ulong dest, uchar *src, int cnt)
+{
+	FPWV *addr = (FPWV *) dest;
+	ulong start;
+	FPW status, data;
+	int i, words = cnt / sizeof (FPW);
+
+	/* Check if Flash is (sufficiently) erased */
+	for (i = 0; i < words; ++i) {
+		data = get_data (src + i * sizeof (FPW));
+		if ((addr[i] & data) != data) {
+			printf ("not erased at %08lx (%lx)\n",
+				(ulong) &addr[i], (ulong) addr[i]);
+			return (2);
+		}
+	}
+
+	/*
+	 * Wait for a free write buffer in both chips.  The command goes
+	 * out only once: a chip that is ready at once would take a second
+	 * 0xE8 for the word count.
+	 */
+	start = get_timer_masked ();
+	*addr = (FPW) 0x00E800E8;		/* write to buffer */
+	while (((status = *addr) & (FPW) 0x00800080) != (FPW) 0x00800080) {
+		if (get_timer_masked () - start > CFG_FLASH_WRITE_TOUT) {
+			*addr = (FPW) 0x00FF00FF;	/* restore read mode */
+			return (1);
+		}
+	}
+
+	*addr = (FPW) ((words - 1) * 0x00010001);	/* count - 1, each chip */
+	for (i = 0; i < words; ++i) {
+		addr[i] = get_data (src + i * sizeof (FPW));
+	}
+	*addr = (FPW) 0x00D000D0;	/* program buffer to flash */
+
+	/* wait while polling the status register */
+	while (((status = *addr) & (FPW) 0x00800080) != (FPW) 0x00800080) {
+		if (get_timer_masked () - start > CFG_FLASH_WRITE_TOUT) {
+			*addr = (FPW) 0x00FF00FF;	/* restore read mode */
+			return (1);
+		}
+	}
+
+	i = 0;
+	if (status & (FPW) 0x001A001A) {	/* program, VPP or lock error */
+		*addr = (FPW) 0x00500050;	/* clear status register */
+		i = 128;
+	}
+	*addr = (FPW) 0x00FF00FF;	/* restore read mode */
+
+	return (i);
+}
+#endif /* CFG_FLASH_USE_BUFFER_WRITE */
+
 /*-----------------------------------------------------------------------
  * Write a word or halfword to Flash, returns:
  * 0 - OK
@@ -395,7 +558,7 @@ int write_buff (flash_info_t *info, uchar *src, ulong addr, ulong cnt)
 static int write_data (flash_info_t *info, ulong dest, FPW data)
 {
 	FPWV *addr = (FPWV *) dest;
-	ulong status;
+	ulong status, start;
 	int flag;
 
 	/* Check if Flash is (sufficiently) erased */
@@ -409,12 +572,12 @@ static int write_data (flash_info_t *info, ulong dest, FPW data)
 	*addr = (FPW) 0x00400040;	/* write setup */
 	*addr = data;
 
-	/* arm simple, non interrupt dependent timer */
-	reset_timer_masked ();
+	/* simple, non interrupt dependent timer */
+	start = get_timer_masked ();
 
 	/* wait while polling the status register */
 	while (((status = *addr) & (FPW) 0x00800080) != (FPW) 0x00800080) {
-		if (get_timer_masked () > CFG_FLASH_WRITE_TOUT) {
+		if (get_timer_masked () - start > CFG_FLASH_WRITE_TOUT) {
 			*addr = (FPW) 0x00FF00FF;	/* restore read mode */
 			return (1);
 		}
@@ -424,12 +587,3 @@ static int write_data (flash_info_t *info, ulong dest, FPW data)
 
 	return (0);
 }
-
-void inline spin_wheel (void)
-{
-	static int p = 0;
-	static char w[] = "\\/-";
-
-	printf ("\010%c", w[p]);
-	(++p == 3) ? (p = 0) : 0;
-}
@@ -76,6 +76,8 @@ static int fit_check_kernel (const void *fit, int os_noffset, int verify);
 
 static void *boot_get_kernel (cmd_tbl_t *cmdtp, int flag,int argc, char *argv[],
 		bootm_headers_t *images, ulong *os_data, ulong *os_len);
+static int bootm_copy_verify (bootm_headers_t *images, ulong load,
+			      ulong data, ulong len);
 extern int do_reset (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[]);
 
 /*
@@ -245,6 +247,17 @@ int do_bootm (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
 	case IH_COMP_NONE:
 		if (load_start == (ulong)os_hdr) {
 			printf ("   XIP %s ... ", type_name);
+		} else if (images.verify_load) {
+			printf ("   Loading and Verifying %s ... ", type_name);
+			if (!bootm_copy_verify (&images, load_start,
+						os_data, os_len)) {
+				/* the source is intact, nothing is lost yet */
+				printf ("Bad Data CRC\n");
+				show_boot_progress (-3);
+				if (iflag)
+					enable_interrupts ();
+				return 1;
+			}
 		} else {
 			printf ("   Loading %s ... ", type_name);
 
@@ -369,6 +382,48 @@ int do_bootm (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
 	return 1;
 }
 
+/*
+ * An uncompressed kernel that is moved to its load address is verified
+ * while it is copied, so the image (often in slow flash) is read only
+ * once.  That needs a front to back copy, i.e. the load address must not
+ * overlap the image data from above.
+ */
+static int bootm_verify_on_load (ulong hdr, ulong data, ulong len,
+				 ulong load, uint8_t comp)
+{
+	return (comp == IH_COMP_NONE) && (load != hdr) &&
+		(load <= data || load >= data + len);
+}
+
+#if defined(CONFIG_FIT)
+static int fit_verify_on_load (const void *fit, int noffset)
+{
+	const void *data;
+	size_t len;
+	ulong load;
+	uint8_t comp;
+
+	if (fit_image_get_data (fit, noffset, &data, &len) ||
+	    fit_image_get_comp (fit, noffset, &comp) ||
+	    fit_image_get_load (fit, noffset, &load))
+		return 0;
+	return bootm_verify_on_load ((ulong)fit, (ulong)data, len, load, comp);
+}
+#endif
+
+/* copy the kernel to its load address and do the deferred data check */
+static int bootm_copy_verify (bootm_headers_t *images, ulong load,
+			      ulong data, ulong len)
+{
+#if defined(CONFIG_FIT)
+	if (images->fit_hdr_os)
+		return fit_image_copy_check_hashes (images->fit_hdr_os,
+				images->fit_noffset_os, (void *)load);
+#endif
+	return crc32_copy_wd (0, (uchar *)load, (uchar *)data, len,
+			CHUNKSZ_CRC32) == image_get_dcrc (&images->legacy_hdr_os_copy);
+}
+
 /**
  * image_get_kernel - verify legacy format kernel image
  * @img_addr: in RAM address of the legacy format image to be verified
@@ -525,7 +580,16 @@ static void *boot_get_kernel (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[]
 	case IMAGE_FORMAT_LEGACY:
 		printf ("## Booting kernel from Legacy Image at %08lx ...\n",
 				img_addr);
-		hdr = image_get_kernel (img_addr, images->verify);
+		/* for a plain kernel, the data CRC may be checked later */
+		hdr = (image_header_t *)img_addr;
+		images->verify_load = images->verify &&
+			(image_get_type (hdr) == IH_TYPE_KERNEL) &&
+			bootm_verify_on_load (img_addr, image_get_data (hdr),
+					image_get_data_size (hdr),
+					image_get_load (hdr),
+					image_get_comp (hdr));
+		hdr = image_get_kernel (img_addr,
+				images->verify && !images->verify_load);
 		if (!hdr)
 			return NULL;
 		show_boot_progress (5);
@@ -604,7 +668,10 @@ static void *boot_get_kernel (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[]
 		printf ("   Trying '%s' kernel subimage\n", fit_uname_kernel);
 
 		show_boot_progress (104);
-		if (!fit_check_kernel (fit_hdr, os_noffset, images->verify))
+		images->verify_load = images->verify &&
+			fit_verify_on_load (fit_hdr, os_noffset);
+		if (!fit_check_kernel (fit_hdr, os_noffset,
+				images->verify && !images->verify_load))
 			return NULL;
 
 		/* get kernel image data address and length */
@@ -94,6 +94,62 @@ U_BOOT_CMD(
 	"      to address 'addr' from dos filesystem\n"
 );
 
+#ifdef CONFIG_FAT_WRITE
+int do_fat_fswrite (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
+{
+	long size;
+	unsigned long offset;
+	unsigned long count;
+	block_dev_desc_t *dev_desc=NULL;
+	int dev=0;
+	int part=1;
+	char *ep;
+
+	if (argc < 6) {
+		printf ("usage: fatwrite <interface> <dev[:part]> <addr> <filename> <bytes>\n");
+		return 1;
+	}
+	dev = (int)simple_strtoul (argv[2], &ep, 16);
+	dev_desc=get_dev(argv[1],dev);
+	if (dev_desc==NULL) {
+		puts ("\n** Invalid boot device **\n");
+		return 1;
+	}
+	if (*ep) {
+		if (*ep != ':') {
+			puts ("\n** Invalid boot device, use `dev[:part]' **\n");
+			return 1;
+		}
+		part = (int)simple_strtoul(++ep, NULL, 16);
+	}
+	if (fat_register_device(dev_desc,part)!=0) {
+		printf ("\n** Unable to use %s %d:%d for fatwrite **\n",argv[1],dev,part);
+		return 1;
+	}
+	offset = simple_strtoul (argv[3], NULL, 16);
+	count = simple_strtoul (argv[5], NULL, 16);
+	size = file_fat_write (argv[4], (unsigned char *) offset, count);
+
+	if(size==-1) {
+		printf("\n** Unable to write \"%s\" to %s %d:%d **\n",argv[4],argv[1],dev,part);
+		return 1;
+	}
+
+	printf ("\n%ld bytes written\n", size);
+
+	return 0;
+}
+
+
+U_BOOT_CMD(
+	fatwrite,	6,	0,	do_fat_fswrite,
+	"fatwrite- write binary file to a dos filesystem\n",
+	"<interface> <dev[:part]> <addr> <filename> <bytes>\n"
+	"    - write 'bytes' of memory at 'addr' to file 'filename'\n"
+	"      (8.3 name, in an existing directory) on 'dev' on 'interface'\n"
+);
+#endif
+
 int do_fat_ls (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
 {
 	char *filename = "/";
@@ -687,6 +687,150 @@ int flash_sect_protect (int p, ulong addr_first, ulong addr_last)
 }
 #endif /* CFG_NO_FLASH */
 
+#if defined(CONFIG_CMD_FLUPDATE) && !defined(CFG_NO_FLASH)
+#define FLUPD_SAME	0	/* flash already holds the data		*/
+#define FLUPD_PROG	1	/* can be programmed without an erase	*/
+#define FLUPD_ERASE	2	/* needs an erase first			*/
+
+/*
+ * Compare new data with flash contents.  Programming can only clear
+ * bits, so data that keeps all 0 bits of the flash (e.g. an erased
+ * sector) may be written without erasing.
+ */
+static int flupdate_cmp (uchar *flash, uchar *src, ulong len)
+{
+	int rc = FLUPD_SAME;
+	ulong i;
+
+	if ((((ulong)flash | (ulong)src | len) & 3) == 0) {
+		ulong *f = (ulong *)flash, *d = (ulong *)src;
+
+		for (i = 0; i < len / 4; ++i) {
+			if (f[i] != d[i]) {
+				if ((f[i] & d[i]) != d[i])
+					return FLUPD_ERASE;
+				rc = FLUPD_PROG;
+			}
+		}
+		return rc;
+	}
+
+	for (i = 0; i < len; ++i) {
+		if (flash[i] != src[i]) {
+			if ((flash[i] & src[i]) != src[i])
+				return FLUPD_ERASE;
+			rc = FLUPD_PROG;
+		}
+	}
+	return rc;
+}
+
+/*
+ * Find the sector holding addr: return its bank, or NULL if addr is
+ * not in flash, and set *sect and the end of the sector *s_end.
+ */
+static flash_info_t *flupdate_sect (ulong addr, int *sect, ulong *s_end)
+{
+	flash_info_t *info;
+	int i;
+
+	if ((info = addr2info (addr)) == NULL)
+		return NULL;
+	for (i = info->sector_count - 1; i > 0; --i)
+		if (info->start[i] <= addr)
+			break;
+	*sect = i;
+	*s_end = (i == info->sector_count - 1) ?
+		 info->start[0] + info->size : info->start[i + 1];
+	return info;
+}
+
+/*
+ * Differential flash update: only sectors whose contents differ are
+ * erased and programmed, saving time and erase cycles when an image
+ * changes little.  Sectors only partially covered by the range are
+ * never erased, since that would destroy the rest of the sector.
+ * The whole range is checked before anything is changed, so an error
+ * does not leave the image half updated.
+ */
+int do_flupdate (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
+{
+	flash_info_t *info;
+	ulong src, dest, len, addr, end, s_end, n, from;
+	int sect, rc, pass;
+	int skipped = 0, erased = 0, programmed = 0;
+
+	if (argc != 4) {
+		printf ("Usage:\n%s\n", cmdtp->usage);
+		return 1;
+	}
+	src  = simple_strtoul (argv[1], NULL, 16);
+	dest = simple_strtoul (argv[2], NULL, 16);
+	len  = simple_strtoul (argv[3], NULL, 16);
+	end  = dest + len;
+
+	/* pass 0 only checks the range, pass 1 updates the flash */
+	for (pass = 0; pass < 2; ++pass) {
+		from = src;
+		for (addr = dest; addr < end; addr = s_end, from += n) {
+			info = flupdate_sect (addr, &sect, &s_end);
+			if (info == NULL) {
+				printf ("Error: 0x%08lx is not in FLASH\n",
+					addr);
+				return 1;
+			}
+			n = ((end < s_end) ? end : s_end) - addr;
+
+			if (ctrlc ()) {
+				puts ("Interrupted\n");
+				return 1;
+			}
+
+			rc = flupdate_cmp ((uchar *)addr, (uchar *)from, n);
+			if (pass == 0) {
+				if (rc == FLUPD_SAME)
+					continue;
+				if (info->protect[sect]) {
+					printf ("Error: sector %d at 0x%08lx "
+						"is protected\n",
+						sect, info->start[sect]);
+					return 1;
+				}
+				if (rc == FLUPD_ERASE &&
+				    (addr != info->start[sect] ||
+				     n != s_end - addr)) {
+					printf ("Error: sector %d at 0x%08lx "
+						"differs but is only partially "
+						"covered\n",
+						sect, info->start[sect]);
+					return 1;
+				}
+				continue;
+			}
+
+			if (rc == FLUPD_SAME) {
+				skipped++;
+				continue;
+			}
+			if (rc == FLUPD_ERASE) {
+				if (flash_erase (info, sect, sect) != 0)
+					return 1;
+				erased++;
+			}
+			if ((rc = flash_write ((char *)from, addr, n)) != 0) {
+				flash_perror (rc);
+				return 1;
+			}
+			programmed++;
+		}
+	}
+
+	printf ("%d sectors: %d skipped, %d erased, %d programmed\n",
+		skipped + programmed, skipped, erased, programmed);
+	return 0;
+}
+#endif /* CONFIG_CMD_FLUPDATE */
+
 
 /**************************************************/
 #if defined(CONFIG_CMD_JFFS2) && defined(CONFIG_JFFS2_CMDLINE)
@@ -745,6 +889,16 @@ U_BOOT_CMD(
 	"protect off all\n    - make all FLASH banks writable\n"
 );
 
+#if defined(CONFIG_CMD_FLUPDATE) && !defined(CFG_NO_FLASH)
+U_BOOT_CMD(
+	flupdate,  4,  0,   do_flupdate,
+	"flupdate- update FLASH, rewriting only sectors that changed\n",
+	"src dest len\n"
+	"    - copy 'len' bytes from 'src' to FLASH at 'dest', skipping\n"
+	"      identical sectors and erasing only where required\n"
+);
+#endif
+
 #undef	TMP_ERASE
 #undef	TMP_PROT_ON
 #undef	TMP_PROT_OFF
@@ -475,14 +475,20 @@ U_BOOT_CMD(nand, 5, 1, do_nand,
 	"nand lock [tight] [status] - bring nand to lock state or display locked pages\n"
 	"nand unlock [offset] [size] - unlock section\n");
 
+/*
+ * Read the first page, get the image size from its header and read
+ * exactly the rest of the image behind it. The .jffs2 variant reads
+ * through a NAND stream which skips bad blocks up to end.
+ */
 static int nand_load_image(cmd_tbl_t *cmdtp, nand_info_t *nand,
-			   ulong offset, ulong addr, char *cmd)
+			   ulong offset, ulong end, ulong addr, char *cmd)
 {
 	int r;
 	char *ep, *s;
-	size_t cnt;
+	size_t cnt, rest;
 	image_header_t *hdr;
 	int jffs2 = 0;
+	nand_stream_t ns;
 #if defined(CONFIG_FIT)
 	const void *fit_hdr = NULL;
 #endif
@@ -496,13 +502,9 @@ static int nand_load_image(cmd_tbl_t *cmdtp, nand_info_t *nand,
 
 	cnt = nand->oobblock;
 	if (jffs2) {
-		nand_read_options_t opts;
-		memset(&opts, 0, sizeof(opts));
-		opts.buffer	= (u_char*) addr;
-		opts.length	= cnt;
-		opts.offset	= offset;
-		opts.quiet      = 1;
-		r = nand_read_opts(nand, &opts);
+		r = nand_stream_open(&ns, nand, offset, end, 1);
+		if (r == 0)
+			r = nand_stream_read(&ns, (u_char *) addr, cnt);
 	} else {
 		r = nand_read(nand, offset, &cnt, (u_char *) addr);
 	}
@@ -510,7 +512,7 @@ static int nand_load_image(cmd_tbl_t *cmdtp, nand_info_t *nand,
 	if (r) {
 		puts("** Read error\n");
 		show_boot_progress (-56);
-		return 1;
+		goto fail;
 	}
 	show_boot_progress (56);
 
@@ -534,20 +536,22 @@ static int nand_load_image(cmd_tbl_t *cmdtp, nand_info_t *nand,
 	default:
 		show_boot_progress (-57);
 		puts ("** Unknown image type\n");
-		return 1;
+		goto fail;
 	}
 
-	if (jffs2) {
-		nand_read_options_t opts;
-		memset(&opts, 0, sizeof(opts));
-		opts.buffer	= (u_char*) addr;
-		opts.length	= cnt;
-		opts.offset	= offset;
-		opts.quiet      = 1;
-		r = nand_read_opts(nand, &opts);
-	} else {
-		r = nand_read(nand, offset, &cnt, (u_char *) addr);
+	/* the first page is in place already */
+	r = 0;
+	if (cnt > nand->oobblock) {
+		rest = cnt - nand->oobblock;
+		if (jffs2)
+			r = nand_stream_read(&ns, (u_char *) addr + nand->oobblock,
+					     rest);
+		else
+			r = nand_read(nand, offset + nand->oobblock, &rest,
+				      (u_char *) addr + nand->oobblock);
 	}
+	if (jffs2)
+		nand_stream_close(&ns);
 
 	if (r) {
 		puts("** Read error\n");
@@ -587,6 +591,11 @@ static int nand_load_image(cmd_tbl_t *cmdtp, nand_info_t *nand,
 		return 1;
 	}
 	return 0;
+
+fail:
+	if (jffs2)
+		nand_stream_close(&ns);
+	return 1;
 }
 
 int do_nandboot(cmd_tbl_t * cmdtp, int flag, int argc, char *argv[])
@@ -614,7 +623,9 @@ int do_nandboot(cmd_tbl_t * cmdtp, int flag, int argc, char *argv[])
 			else
 				addr = CFG_LOAD_ADDR;
 			return nand_load_image(cmdtp, &nand_info[dev->id->num],
-					       part->offset, addr, argv[0]);
+					       part->offset,
+					       part->offset + part->size,
+					       addr, argv[0]);
 		}
 	}
 #endif
@@ -664,7 +675,8 @@ usage:
 	}
 	show_boot_progress(55);
 
-	return nand_load_image(cmdtp, &nand_info[idx], offset, addr, argv[0]);
+	return nand_load_image(cmdtp, &nand_info[idx], offset,
+			       nand_info[idx].size, addr, argv[0]);
 }
 
 U_BOOT_CMD(nboot, 4, 1, do_nandboot,
@@ -45,14 +45,35 @@ U_BOOT_CMD(
 
 int do_tftpb (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
 {
+#ifdef CONFIG_GUNZIP_STREAM
+	int rcode;
+
+	if (argc > 1 && strcmp (argv[1], "-z") == 0) {
+		TftpGunzip = 1;
+		argv[1] = argv[0];
+		rcode = netboot_common (TFTP, cmdtp, argc - 1, argv + 1);
+		TftpGunzip = 0;
+		return rcode;
+	}
+#endif
 	return netboot_common (TFTP, cmdtp, argc, argv);
 }
 
+#ifdef CONFIG_GUNZIP_STREAM
+U_BOOT_CMD(
+	tftpboot,	4,	1,	do_tftpb,
+	"tftpboot- boot image via network using TFTP protocol\n",
+	"[-z] [loadAddress] [[hostIPaddr:]bootfilename]\n"
+	"    - with -z, the file is gzip compressed and is uncompressed\n"
+	"      to loadAddress while it is being received\n"
+);
+#else
 U_BOOT_CMD(
 	tftpboot,	3,	1,	do_tftpb,
 	"tftpboot- boot image via network using TFTP protocol\n",
 	"[loadAddress] [[hostIPaddr:]bootfilename]\n"
 );
+#endif
 
 int do_rarpb (cmd_tbl_t *cmdtp, int flag, int argc, char *argv[])
 {
@@ -75,6 +75,159 @@ DECLARE_GLOBAL_DATA_PTR;
 static const unsigned long baudrate_table[] = CFG_BAUDRATE_TABLE;
 #define	N_BAUDRATES (sizeof(baudrate_table) / sizeof(baudrate_table[0]))
 
+/************************************************************************
+ * Hash index over the RAM copy of the environment
+ *
+ * The packed "name=value" list stays the environment proper: saveenv,
+ * printenv and the boot code use it as is. The index maps the hash of
+ * a name to the offset of its entry (linear probing, first definition
+ * first), so getenv() and setenv() don't scan the list. It is kept up
+ * to date by _do_setenv() and rebuilt whenever the address or the CRC
+ * of the environment changes behind its back.
+ */
+
+#ifndef CFG_ENV_HASH_SIZE
+#define CFG_ENV_HASH_SIZE	256
+#endif
+#if CFG_ENV_HASH_SIZE & (CFG_ENV_HASH_SIZE - 1)
+#error "CFG_ENV_HASH_SIZE must be a power of 2"
+#endif
+#define ENV_HASH_MASK	(CFG_ENV_HASH_SIZE - 1)
+
+extern env_t *env_ptr;
+
+static int env_hash[CFG_ENV_HASH_SIZE];	/* entry offset + 1, 0 = free */
+static int env_hash_count;	/* entries, -1 if the index is unusable */
+static int env_hash_end;	/* offset of the final '\0' */
+static ulong env_hash_addr;	/* environment the index belongs to */
+static uint32_t env_hash_crc;
+
+/* Hash of a name, up to '\0' or '=' */
+static int env_hash_name (const uchar *s)
+{
+	uint h = 0;
+
+	while (*s != '\0' && *s != '=')
+		h = h * 31 + *s++;
+
+	return h & ENV_HASH_MASK;
+}
+
+static int env_hash_insert (const uchar *env, int off)
+{
+	int slot;
+
+	/* keep a quarter free so that probe chains stay short */
+	if (env_hash_count >= CFG_ENV_HASH_SIZE / 4 * 3)
+		return -1;
+
+	slot = env_hash_name(env + off);
+	while (env_hash[slot])
+		slot = (slot + 1) & ENV_HASH_MASK;
+	env_hash[slot] = off + 1;
+	env_hash_count++;
+
+	return 0;
+}
+
+/* Remove a slot, moving up later entries of its probe chain */
+static void env_hash_remove (const uchar *env, int slot)
+{
+	int i = slot, j, k;
+
+	env_hash[i] = 0;
+	for (j = (i + 1) & ENV_HASH_MASK; env_hash[j];
+	     j = (j + 1) & ENV_HASH_MASK) {
+		k = env_hash_name(env + env_hash[j] - 1);
+		/* stays if its home slot lies cyclically in (i, j] */
+		if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+			continue;
+		env_hash[i] = env_hash[j];
+		env_hash[j] = 0;
+		i = j;
+	}
+	env_hash_count--;
+}
+
+static void env_hash_build (void)
+{
+	uchar *env = env_get_addr(0);
+	int i, nxt;
+
+	memset(env_hash, 0, sizeof(env_hash));
+	env_hash_count = 0;
+	env_hash_addr = gd->env_addr;
+	env_hash_crc = env_ptr->crc;
+
+	for (i = 0; env[i] != '\0'; i = nxt + 1) {
+		for (nxt = i; env[nxt] != '\0'; ++nxt) {
+			if (nxt >= ENV_SIZE)
+				goto unusable;
+		}
+		if (env_hash_insert(env, i))
+			goto unusable;
+	}
+	env_hash_end = i;
+	return;
+
+unusable:
+	env_hash_count = -1;
+}
+
+/* Returns 1 if the index may be used */
+static int env_hash_ok (void)
+{
+#ifdef CONFIG_AMIGAONEG3SE
+	return 0;	/* the environment needs enable_nvram() */
+#endif
+	if (!(gd->flags & GD_FLG_RELOC) || !gd->env_valid)
+		return 0;
+	if (env_hash_addr != gd->env_addr || env_hash_crc != env_ptr->crc)
+		env_hash_build();
+
+	return env_hash_count >= 0;
+}
+
+/*
+ * Look up a name (or 'name=value'), like envmatch(): returns the
+ * value offset or -1, the slot and entry offset through *slotp and
+ * *offp if found.
+ */
+static int env_hash_find (const uchar *name, int *slotp, int *offp)
+{
+	const uchar *env = env_get_addr(0);
+	const uchar *s1;
+	int slot, i2;
+
+	for (slot = env_hash_name(name); env_hash[slot];
+	     slot = (slot + 1) & ENV_HASH_MASK) {
+		s1 = name;
+		i2 = env_hash[slot] - 1;
+		while (*s1 == env[i2++]) {
+			if (*s1++ == '=')
+				goto found;
+		}
+		if (*s1 == '\0' && env[i2 - 1] == '=')
+			goto found;
+		continue;
+found:
+		if (slotp)
+			*slotp = slot;
+		if (offp)
+			*offp = env_hash[slot] - 1;
+		return i2;
+	}
+
+	return -1;
+}
+
+/* Build the index for a newly relocated environment */
+void env_hash_init (void)
+{
+	env_hash_addr = 0;
+	env_hash_ok();
+}
+
 
 /************************************************************************
  * Command interface: print one or all environment variables
@@ -147,6 +300,7 @@ int _do_setenv (int flag, int argc, char *argv[])
 	uchar *env, *nxt = NULL;
 	char *name;
 	bd_t *bd = gd->bd;
+	int   hashed, slot = 0, off;
 
 	uchar *env_data = env_get_addr(0);
 
@@ -164,11 +318,20 @@ int _do_setenv (int flag, int argc, char *argv[])
 	 * search if variable with this name already exists
 	 */
 	oldval = -1;
-	for (env=env_data; *env; env=nxt+1) {
-		for (nxt=env; *nxt; ++nxt)
-			;
-		if ((oldval = envmatch((uchar *)name, env-env_data)) >= 0)
-			break;
+	hashed = env_hash_ok();
+	if (hashed) {
+		oldval = env_hash_find((uchar *)name, &slot, &off);
+		if (oldval >= 0) {
+			env = env_data + off;
+			nxt = env + oldval - off + strlen((char *)env_data + oldval);
+		}
+	} else {
+		for (env=env_data; *env; env=nxt+1) {
+			for (nxt=env; *nxt; ++nxt)
+				;
+			if ((oldval = envmatch((uchar *)name, env-env_data)) >= 0)
+				break;
+		}
 	}
 
 	/*
@@ -254,21 +417,36 @@ int _do_setenv (int flag, int argc, char *argv[])
 			}
 		}
 
-		if (*++nxt == '\0') {
-			if (env > env_data) {
-				env--;
-			} else {
-				*env = '\0';
+		if (hashed) {
+			/* move the rest up, final '\0' included */
+			env_hash_remove(env_data, slot);
+			len = nxt + 1 - env;
+			memmove(env, nxt + 1, env_hash_end - (nxt - env_data));
+			env_hash_end -= len;
+			/* an empty list is "\0\0", as the code below leaves it */
+			if (env_hash_end == 0)
+				env_data[1] = '\0';
+			for (i = 0; i < CFG_ENV_HASH_SIZE; i++) {
+				if (env_hash[i] > off + 1)
+					env_hash[i] -= len;
 			}
 		} else {
-			for (;;) {
-				*env = *nxt++;
-				if ((*env == '\0') && (*nxt == '\0'))
-					break;
-				++env;
+			if (*++nxt == '\0') {
+				if (env > env_data) {
+					env--;
+				} else {
+					*env = '\0';
+				}
+			} else {
+				for (;;) {
+					*env = *nxt++;
+					if ((*env == '\0') && (*nxt == '\0'))
+						break;
+					++env;
+				}
 			}
+			*++env = '\0';
 		}
-		*++env = '\0';
 	}
 
 #ifdef CONFIG_NET_MULTI
@@ -286,16 +464,23 @@ int _do_setenv (int flag, int argc, char *argv[])
 	/* Delete only ? */
 	if ((argc < 3) || argv[2] == NULL) {
 		env_crc_update ();
+		if (hashed)
+			env_hash_crc = env_ptr->crc;
 		return 0;
 	}
 
 	/*
 	 * Append new definition at the end
 	 */
-	for (env=env_data; *env || *(env+1); ++env)
-		;
-	if (env > env_data)
-		++env;
+	if (hashed && env_hash_count >= 0) {
+		env = env_data + env_hash_end;
+	} else {
+		hashed = 0;
+		for (env=env_data; *env || *(env+1); ++env)
+			;
+		if (env > env_data)
+			++env;
+	}
 	/*
 	 * Overflow when:
 	 * "name" + "=" + "val" +"\0\0"  > ENV_SIZE - (env-env_data)
@@ -324,6 +509,13 @@ int _do_setenv (int flag, int argc, char *argv[])
 
 	/* Update CRC */
 	env_crc_update ();
+	if (hashed) {
+		off = env_hash_end;
+		env_hash_end = env - env_data;
+		if (env_hash_insert(env_data, off))
+			env_hash_count = -1;
+		env_hash_crc = env_ptr->crc;
+	}
 
 	/*
 	 * Some variables should be updated when the corresponding
@@ -499,6 +691,11 @@ char *getenv (char *name)
 
 	WATCHDOG_RESET();
 
+	if (env_hash_ok()) {
+		i = env_hash_find((uchar *)name, NULL, NULL);
+		return (i < 0) ? NULL : (char *)env_get_addr(i);
+	}
+
 	for (i=0; env_get_char(i) != '\0'; i=nxt+1) {
 		int val;
 
@@ -519,6 +716,18 @@ int getenv_r (char *name, char *buf, unsigned len)
 {
 	int i, nxt;
 
+	if (env_hash_ok()) {
+		int val, n = 0;
+
+		if ((val = env_hash_find((uchar *)name, NULL, NULL)) < 0)
+			return (-1);
+		while ((len > n++) && (*buf++ = env_get_char(val++)) != '\0')
+			;
+		if (len == n)
+			*buf = '\0';
+		return (n);
+	}
+
 	for (i=0; env_get_char(i) != '\0'; i=nxt+1) {
 		int val, n;
 
@@ -262,6 +262,8 @@ void env_relocate (void)
 #ifdef CONFIG_AMIGAONEG3SE
 	disable_nvram();
 #endif
+
+	env_hash_init();
 }
 
 #ifdef CONFIG_AUTO_COMPLETE
@@ -111,3 +111,211 @@ int gunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp)
 
 	return (0);
 }
+
+#ifdef CONFIG_GUNZIP_STREAM
+/*
+ * Streaming gunzip: the gzip file is handed over in arbitrary pieces
+ * (e.g. TFTP data blocks as they arrive) and inflated straight into
+ * the destination, so there is no staging copy of the compressed data
+ * and inflating overlaps with waiting for the next piece.
+ */
+#define GZS_MAGIC	0	/* fixed 10 byte header	*/
+#define GZS_XLEN	1	/* length of extra field	*/
+#define GZS_EXTRA	2	/* extra field data		*/
+#define GZS_NAME	3	/* original file name		*/
+#define GZS_COMMENT	4	/* file comment			*/
+#define GZS_HCRC	5	/* header CRC16			*/
+#define GZS_DATA	6	/* deflate stream		*/
+#define GZS_TRAILER	7	/* CRC32 and ISIZE		*/
+#define GZS_DONE	8
+#define GZS_ERROR	9
+
+/* gzip flag that makes a header field present, indexed by state */
+static const unsigned char gzs_field_flag[GZS_DATA] = {
+	0, EXTRA_FIELD, EXTRA_FIELD, ORIG_NAME, COMMENT, HEAD_CRC
+};
+
+static z_stream gzs;
+static int gzs_active;		/* gzs holds an inflate state		*/
+static int gzs_state;
+static int gzs_flags;		/* gzip header flags			*/
+static unsigned long gzs_cnt;	/* bytes seen of the current field	*/
+static unsigned long gzs_xlen;	/* size of the extra field		*/
+static unsigned char gzs_buf[10];	/* fixed header, later trailer	*/
+static uint32_t gzs_crc;	/* CRC32 of the inflated data		*/
+
+static void gzs_next_field(void)
+{
+	gzs_cnt = 0;
+	do {
+		gzs_state++;
+	} while (gzs_state < GZS_DATA &&
+		 (gzs_flags & gzs_field_flag[gzs_state]) == 0);
+}
+
+/* Parse gzip header bytes, return the number of bytes consumed */
+static unsigned long gzs_header(unsigned char *src, unsigned long len)
+{
+	unsigned long i = 0;
+	unsigned char c;
+
+	while (i < len && gzs_state < GZS_DATA) {
+		c = src[i++];
+		switch (gzs_state) {
+		case GZS_MAGIC:
+			gzs_buf[gzs_cnt++] = c;
+			if (gzs_cnt < 10)
+				break;
+			if (gzs_buf[0] != 0x1f || gzs_buf[1] != 0x8b ||
+			    gzs_buf[2] != DEFLATED ||
+			    (gzs_buf[3] & RESERVED) != 0) {
+				puts ("Error: Bad gzipped data\n");
+				gzs_state = GZS_ERROR;
+				return i;
+			}
+			gzs_flags = gzs_buf[3];
+			gzs_next_field();
+			break;
+		case GZS_XLEN:
+			if (gzs_cnt++ == 0) {
+				gzs_xlen = c;
+				break;
+			}
+			gzs_xlen |= c << 8;
+			gzs_next_field();
+			if (gzs_xlen == 0)
+				gzs_next_field();
+			break;
+		case GZS_EXTRA:
+			if (++gzs_cnt == gzs_xlen)
+				gzs_next_field();
+			break;
+		case GZS_NAME:
+		case GZS_COMMENT:
+			if (c == 0)
+				gzs_next_field();
+			break;
+		case GZS_HCRC:
+			if (++gzs_cnt == 2)
+				gzs_next_field();
+			break;
+		}
+	}
+	return i;
+}
+
+static void gzs_trailer(unsigned char *src, unsigned long len)
+{
+	while (len-- && gzs_cnt < 8)
+		gzs_buf[gzs_cnt++] = *src++;
+	if (gzs_cnt == 8)
+		gzs_state = GZS_DONE;
+}
+
+int gunzip_stream_start(void *dst, int dstlen)
+{
+	int r;
+
+	if (gzs_active)		/* restarted transfer */
+		inflateEnd(&gzs);
+	gzs_active = 0;
+
+	memset(&gzs, 0, sizeof(gzs));
+	gzs.zalloc = zalloc;
+	gzs.zfree = zfree;
+#if defined(CONFIG_HW_WATCHDOG) || defined(CONFIG_WATCHDOG)
+	gzs.outcb = (cb_func)WATCHDOG_RESET;
+#else
+	gzs.outcb = Z_NULL;
+#endif	/* CONFIG_HW_WATCHDOG */
+
+	r = inflateInit2(&gzs, -MAX_WBITS);
+	if (r != Z_OK) {
+		printf ("Error: inflateInit2() returned %d\n", r);
+		gzs_state = GZS_ERROR;
+		return (-1);
+	}
+	gzs_active = 1;
+	gzs.next_out = dst;
+	gzs.avail_out = dstlen;
+	gzs_state = GZS_MAGIC;
+	gzs_cnt = 0;
+	gzs_crc = 0;
+
+	return (0);
+}
+
+int gunzip_stream_feed(unsigned char *src, unsigned long len)
+{
+	unsigned char *out;
+	unsigned long n;
+	int r;
+
+	if (gzs_state < GZS_DATA) {
+		n = gzs_header(src, len);
+		src += n;
+		len -= n;
+	}
+
+	if (gzs_state == GZS_DATA && len) {
+		gzs.next_in = src;
+		gzs.avail_in = len;
+		out = gzs.next_out;
+		r = inflate(&gzs, Z_NO_FLUSH);
+		gzs_crc = crc32(gzs_crc, out, gzs.next_out - out);
+		if (r == Z_STREAM_END) {
+			gzs_state = GZS_TRAILER;
+			gzs_cnt = 0;
+		} else if (r != Z_OK && r != Z_BUF_ERROR) {
+			printf ("Error: inflate() returned %d\n", r);
+			gzs_state = GZS_ERROR;
+		} else if (gzs.avail_in != 0) {
+			puts ("Error: gunzip output buffer too small\n");
+			gzs_state = GZS_ERROR;
+		}
+		src = gzs.next_in;
+		len = gzs.avail_in;
+	}
+
+	if (gzs_state == GZS_TRAILER)
+		gzs_trailer(src, len);
+
+	return (gzs_state == GZS_ERROR ? -1 : 0);
+}
+
+int gunzip_stream_end(unsigned long *lenp)
+{
+	uint32_t crc, isize;
+	int state = gzs_state;
+
+	if (gzs_active)
+		inflateEnd(&gzs);
+	gzs_active = 0;
+	gzs_state = GZS_ERROR;
+
+	if (state == GZS_ERROR)
+		return (-1);
+	if (state != GZS_DONE) {
+		puts ("Error: gunzip out of data\n");
+		return (-1);
+	}
+
+	crc = gzs_buf[0] | (gzs_buf[1] << 8) |
+	      (gzs_buf[2] << 16) | (gzs_buf[3] << 24);
+	isize = gzs_buf[4] | (gzs_buf[5] << 8) |
+		(gzs_buf[6] << 16) | (gzs_buf[7] << 24);
+	if (crc != gzs_crc) {
+		printf ("Error: gunzip CRC mismatch: %08x != %08x\n",
+			gzs_crc, crc);
+		return (-1);
+	}
+	if (isize != (uint32_t)gzs.total_out) {
+		printf ("Error: gunzip size mismatch: %lu != %u\n",
+			gzs.total_out, isize);
+		return (-1);
+	}
+	*lenp = gzs.total_out;
+
+	return (0);
+}
+#endif /* CONFIG_GUNZIP_STREAM */
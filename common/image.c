@@ -1920,6 +1920,40 @@ static int calculate_hash (const void *data, int data_len, const char *algo,
 	return 0;
 }
 
+#ifndef USE_HOSTCC
+/**
+ * calculate_hash_copy - calculate hash while copying the input data
+ * @dst: where to copy the data to
+ *
+ * calculate_hash_copy() works like calculate_hash(), but also copies the
+ * input data to dst; crc32 and sha1 are computed during the copy, so the
+ * source is read only once.  The areas may only overlap if dst is below
+ * data.
+ *
+ * returns:
+ *     0, on success
+ *    -1, when algo is unsupported
+ */
+static int calculate_hash_copy (void *dst, const void *data, int data_len,
+			const char *algo, uint8_t *value, int *value_len)
+{
+	if (strcmp (algo, "crc32") == 0 ) {
+		*((uint32_t *)value) = crc32_copy_wd (0, dst, data, data_len,
+							CHUNKSZ_CRC32);
+		*((uint32_t *)value) = cpu_to_uimage (*((uint32_t *)value));
+		*value_len = 4;
+		return 0;
+	} else if (strcmp (algo, "sha1") == 0 ) {
+		sha1_csum_copy_wd (dst, (unsigned char *) data, data_len,
+				(unsigned char *) value, CHUNKSZ_SHA1);
+		*value_len = 20;
+		return 0;
+	}
+	memmove_wd (dst, (void *)data, data_len, CHUNKSZ);
+	return calculate_hash (dst, data_len, algo, value, value_len);
+}
+#endif /* !USE_HOSTCC */
+
 #ifdef USE_HOSTCC
 /**
  * fit_set_hashes - process FIT component image nodes and calculate hashes
@@ -2105,6 +2139,28 @@ int fit_image_hash_set_value (void *fit, int noffset, uint8_t *value,
  *     0, otherwise (or on error)
  */
 int fit_image_check_hashes (const void *fit, int image_noffset)
+{
+	return fit_image_copy_check_hashes (fit, image_noffset, NULL);
+}
+
+/**
+ * fit_image_copy_check_hashes - copy image data and verify its hashes
+ * @fit: pointer to the FIT format image header
+ * @image_noffset: component image node offset
+ * @dst: where to copy the image data to, or NULL to only verify
+ *
+ * fit_image_copy_check_hashes() does the same checks as
+ * fit_image_check_hashes() and also copies the image data to dst.  The
+ * first hash is calculated during the copy, any further ones from the
+ * copy, so the image is read only once.  The areas may only overlap if
+ * dst is below the image data.
+ *
+ * returns:
+ *     1, if all hashes are valid
+ *     0, otherwise (or on error)
+ */
+int fit_image_copy_check_hashes (const void *fit, int image_noffset,
+				void *dst)
 {
 	const void	*data;
 	size_t		size;
@@ -2115,6 +2171,7 @@ int fit_image_check_hashes (const void *fit, int image_noffset)
 	int		value_len;
 	int		noffset;
 	int		ndepth;
+	int		rc;
 	char		*err_msg = "";
 
 	/* Get image data and data length */
@@ -2152,7 +2209,16 @@ int fit_image_check_hashes (const void *fit, int image_noffset)
 				goto error;
 			}
 
-			if (calculate_hash (data, size, algo, value, &value_len)) {
+#ifndef USE_HOSTCC
+			if (dst) {
+				rc = calculate_hash_copy (dst, data, size,
+						algo, value, &value_len);
+				data = dst;	/* hash the copy from now on */
+				dst = NULL;
+			} else
+#endif
+			rc = calculate_hash (data, size, algo, value, &value_len);
+			if (rc) {
 				err_msg = "Unsupported hash algorithm";
 				goto error;
 			}
@@ -2168,6 +2234,10 @@ int fit_image_check_hashes (const void *fit, int image_noffset)
 		}
 	}
 
+#ifndef USE_HOSTCC
+	if (dst)	/* no hashes at all */
+		memmove_wd (dst, (void *)data, size, CHUNKSZ);
+#endif
 	return 1;
 
 error:
@@ -0,0 +1,91 @@
+/*
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * Polled, descriptor-less memory to memory DMA, e.g. for the dma_xfer
+ * hook of a NAND chip on the static memory bus:
+ *
+ *	read:	pxa_dma_xfer(chan, nand_data_port, buf, len, DCMD_INCTRGADDR)
+ *	write:	pxa_dma_xfer(chan, buf, nand_data_port, len, DCMD_INCSRCADDR)
+ *
+ * U-Boot runs the PXA with the MMU and so the data cache off (see
+ * dcache_enable() in cpu.c), so buffers need no cache maintenance.
+ */
+
+#include <common.h>
+#include <asm/arch/pxa-regs.h>
+
+#ifdef CONFIG_PXA_DMA
+
+/* Bytes per channel start; DCMD_LENGTH allows up to 8K - 1 */
+#define PXA_DMA_CHUNK	4096
+
+/*
+ * Move len bytes from src to dst on channel chan; dcmd selects which
+ * of the addresses increment. Both addresses must be 8 byte aligned
+ * and len a multiple of 4. Returns 0 on success, -1 if the transfer
+ * can not be done (the caller then falls back to the CPU) or failed.
+ */
+int pxa_dma_xfer (int chan, ulong src, ulong dst, ulong len, ulong dcmd)
+{
+	ulong n, start;
+
+	if (chan < 0 || chan > 15 || ((src | dst) & 7) || (len & 3))
+		return -1;
+
+	/* memory to memory: no flow control, and WIDTH must be 0 */
+	dcmd &= DCMD_INCSRCADDR | DCMD_INCTRGADDR;
+	dcmd |= DCMD_BURST32;
+
+	while (len) {
+		n = len > PXA_DMA_CHUNK ? PXA_DMA_CHUNK : len;
+
+		DCSR(chan) = DCSR_NODESC | DCSR_ENDINTR | DCSR_STARTINTR |
+			     DCSR_BUSERR;
+		DSADR(chan) = src;
+		DTADR(chan) = dst;
+		DCMD(chan) = dcmd | n;
+		DCSR(chan) = DCSR_RUN | DCSR_NODESC;
+
+		start = get_timer (0);
+		while (!(DCSR(chan) & DCSR_STOPSTATE)) {
+			if (get_timer (start) > CFG_HZ) {
+				DCSR(chan) = DCSR_NODESC;
+				printf ("DMA channel %d timeout\n", chan);
+				return -1;
+			}
+		}
+		if (DCSR(chan) & DCSR_BUSERR) {
+			DCSR(chan) = DCSR_NODESC | DCSR_BUSERR;
+			printf ("DMA channel %d bus error\n", chan);
+			return -1;
+		}
+
+		if (dcmd & DCMD_INCSRCADDR)
+			src += n;
+		if (dcmd & DCMD_INCTRGADDR)
+			dst += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+#endif /* CONFIG_PXA_DMA */
@@ -129,6 +129,11 @@ static struct nand_oobinfo nand_oob_128 = {
 /* This is used for padding purposes in nand_write_oob */
 static u_char *ffchars;
 
+/* Shorter transfers are not handed to the board's DMA hook */
+#ifndef CFG_NAND_DMA_MIN
+#define CFG_NAND_DMA_MIN	512
+#endif
+
 /*
  * NAND low-level MTD interface functions
  */
@@ -421,6 +426,201 @@ static int nand_verify_buf16(struct mtd_info *mtd, const u_char *buf, int len)
 	return 0;
 }
 
+/**
+ * nand_dma - [INTERN] hand a buffer transfer to the board's DMA hook
+ * @mtd:	MTD device structure
+ * @buf:	data buffer
+ * @len:	number of bytes to transfer
+ * @write:	transfer direction, non zero to write to the chip
+ *
+ * flush_cache() is called on the buffer first for CPUs that run with
+ * the data cache on; where it is a no-op (ARM, including PXA, which
+ * never enables its data cache here) nothing is cached that could go
+ * stale. A hook on a CPU with a data cache but without a working
+ * flush_cache() must do its own cache maintenance.
+ * Returns 0 if the hook did the transfer.
+ */
+static int nand_dma(struct mtd_info *mtd, u_char *buf, int len, int write)
+{
+	struct nand_chip *this = mtd->priv;
+
+	if (!this->dma_xfer || len < CFG_NAND_DMA_MIN)
+		return -1;
+
+	flush_cache((unsigned long)buf, len);
+	return this->dma_xfer(mtd, buf, len, write);
+}
+
+/*
+ * Bytes to move in bus width cycles before @buf is word aligned, or -1
+ * if the word data path can not be used for this transfer at all.
+ */
+static int nand_word_head(struct nand_chip *this, const u_char *buf, int len)
+{
+	int head = -(unsigned long)buf & 3;
+
+	if (!(this->options & NAND_WORD_IO) || len < head + 4)
+		return -1;
+	return head;
+}
+
+static void nand_read_words(struct nand_chip *this, u32 *p, int n)
+{
+	void __iomem *io = this->IO_ADDR_R;
+
+#ifdef CONFIG_ARM
+	if ((this->options & NAND_BURST_IO) == NAND_BURST_IO) {
+		for (; n >= 8; n -= 8)
+			__asm__ __volatile__(
+				"ldmia	%1, {r4-r7}\n"
+				"stmia	%0!, {r4-r7}\n"
+				"ldmia	%1, {r4-r7}\n"
+				"stmia	%0!, {r4-r7}\n"
+				: "+r" (p) : "r" (io)
+				: "r4", "r5", "r6", "r7", "memory");
+	}
+#endif
+	for (; n >= 4; n -= 4, p += 4) {
+		p[0] = __raw_readl(io);
+		p[1] = __raw_readl(io);
+		p[2] = __raw_readl(io);
+		p[3] = __raw_readl(io);
+	}
+	while (n--)
+		*p++ = __raw_readl(io);
+}
+
+static void nand_write_words(struct nand_chip *this, const u32 *p, int n)
+{
+	void __iomem *io = this->IO_ADDR_W;
+
+#ifdef CONFIG_ARM
+	if ((this->options & NAND_BURST_IO) == NAND_BURST_IO) {
+		for (; n >= 8; n -= 8)
+			__asm__ __volatile__(
+				"ldmia	%0!, {r4-r7}\n"
+				"stmia	%1, {r4-r7}\n"
+				"ldmia	%0!, {r4-r7}\n"
+				"stmia	%1, {r4-r7}\n"
+				: "+r" (p) : "r" (io)
+				: "r4", "r5", "r6", "r7", "memory");
+	}
+#endif
+	for (; n >= 4; n -= 4, p += 4) {
+		__raw_writel(p[0], io);
+		__raw_writel(p[1], io);
+		__raw_writel(p[2], io);
+		__raw_writel(p[3], io);
+	}
+	while (n--)
+		__raw_writel(*p++, io);
+}
+
+/**
+ * nand_write_buf_fast - [DEFAULT] write buffer to chip by words or DMA
+ * @mtd:	MTD device structure
+ * @buf:	data buffer
+ * @len:	number of bytes to write
+ *
+ * Used instead of the bus width functions for chips with NAND_WORD_IO
+ * or a dma_xfer hook. Unaligned heads and tails go through those.
+ */
+static void nand_write_buf_fast(struct mtd_info *mtd, const u_char *buf, int len)
+{
+	struct nand_chip *this = mtd->priv;
+	int busw = this->options & NAND_BUSWIDTH_16;
+	int head, tail;
+
+	if (nand_dma(mtd, (u_char *)buf, len, 1) == 0)
+		return;
+
+	head = nand_word_head(this, buf, len);
+	if (head < 0) {
+		if (busw)
+			nand_write_buf16(mtd, buf, len);
+		else
+			nand_write_buf(mtd, buf, len);
+		return;
+	}
+
+	tail = (len - head) & 3;
+	if (head)
+		(busw ? nand_write_buf16 : nand_write_buf)(mtd, buf, head);
+	nand_write_words(this, (const u32 *)(buf + head), (len - head) >> 2);
+	if (tail)
+		(busw ? nand_write_buf16 : nand_write_buf)(mtd, buf + len - tail, tail);
+}
+
+/**
+ * nand_read_buf_fast - [DEFAULT] read chip data into buffer by words or DMA
+ * @mtd:	MTD device structure
+ * @buf:	buffer to store date
+ * @len:	number of bytes to read
+ *
+ * Used instead of the bus width functions for chips with NAND_WORD_IO
+ * or a dma_xfer hook. Unaligned heads and tails go through those.
+ */
+static void nand_read_buf_fast(struct mtd_info *mtd, u_char *buf, int len)
+{
+	struct nand_chip *this = mtd->priv;
+	int busw = this->options & NAND_BUSWIDTH_16;
+	int head, tail;
+
+	if (nand_dma(mtd, buf, len, 0) == 0)
+		return;
+
+	head = nand_word_head(this, buf, len);
+	if (head < 0) {
+		if (busw)
+			nand_read_buf16(mtd, buf, len);
+		else
+			nand_read_buf(mtd, buf, len);
+		return;
+	}
+
+	tail = (len - head) & 3;
+	if (head)
+		(busw ? nand_read_buf16 : nand_read_buf)(mtd, buf, head);
+	nand_read_words(this, (u32 *)(buf + head), (len - head) >> 2);
+	if (tail)
+		(busw ? nand_read_buf16 : nand_read_buf)(mtd, buf + len - tail, tail);
+}
+
+/**
+ * nand_verify_buf_fast - [DEFAULT] Verify chip data against buffer by words
+ * @mtd:	MTD device structure
+ * @buf:	buffer containing the data to compare
+ * @len:	number of bytes to compare
+ *
+ * Counterpart of nand_read_buf_fast(); no DMA, as the data is only compared.
+ */
+static int nand_verify_buf_fast(struct mtd_info *mtd, const u_char *buf, int len)
+{
+	struct nand_chip *this = mtd->priv;
+	int busw = this->options & NAND_BUSWIDTH_16;
+	void __iomem *io = this->IO_ADDR_R;
+	const u32 *p;
+	int head, tail, i;
+
+	head = nand_word_head(this, buf, len);
+	if (head < 0)
+		return busw ? nand_verify_buf16(mtd, buf, len) :
+			nand_verify_buf(mtd, buf, len);
+
+	tail = (len - head) & 3;
+	if (head && (busw ? nand_verify_buf16 : nand_verify_buf)(mtd, buf, head))
+		return -EFAULT;
+	p = (const u32 *)(buf + head);
+	for (i = (len - head) >> 2; i > 0; i--)
+		if (*p++ != __raw_readl(io))
+			return -EFAULT;
+	if (tail)
+		return (busw ? nand_verify_buf16 : nand_verify_buf)(mtd,
+			buf + len - tail, tail);
+
+	return 0;
+}
+
 /**
  * nand_block_bad - [DEFAULT] Read bad block marker from the chip
  * @mtd:	MTD device structure
@@ -919,11 +1119,13 @@ static int nand_write_page (struct mtd_info *mtd, struct nand_chip *this, int pa
 		this->write_buf(mtd, this->data_poi, mtd->oobblock);
 		break;
 
-	/* Software ecc 3/256, write all */
+	/* Software ecc 3/256, 3/512 or BCH, write all */
 	case NAND_ECC_SOFT:
+	case NAND_ECC_SOFT_512:
+	case NAND_ECC_SOFT_BCH:
 		for (; eccsteps; eccsteps--) {
 			this->calculate_ecc(mtd, &this->data_poi[datidx], ecc_code);
-			for (i = 0; i < 3; i++, eccidx++)
+			for (i = 0; i < this->eccbytes; i++, eccidx++)
 				oob_buf[oob_config[eccidx]] = ecc_code[i];
 			datidx += this->eccsize;
 		}
@@ -1243,8 +1445,10 @@ static int nand_read_ecc (struct mtd_info *mtd, loff_t from, size_t len,
 		}
 
 		case NAND_ECC_SOFT:	/* Software ECC 3/256: Read in a page + oob data */
+		case NAND_ECC_SOFT_512:
+		case NAND_ECC_SOFT_BCH:
 			this->read_buf(mtd, data_poi, end);
-			for (i = 0, datidx = 0; eccsteps; eccsteps--, i+=3, datidx += ecc)
+			for (i = 0, datidx = 0; eccsteps; eccsteps--, i+=eccbytes, datidx += ecc)
 				this->calculate_ecc(mtd, &data_poi[datidx], &ecc_calc[i]);
 			break;
 
@@ -2321,6 +2525,9 @@ int nand_scan (struct mtd_info *mtd, int maxchips)
 {
 	int i, j, nand_maf_id, nand_dev_id, busw;
 	struct nand_chip *this = mtd->priv;
+#ifdef CONFIG_NAND_ECC_BCH
+	int bchbytes = 0;
+#endif
 
 	/* Get buswidth to select the correct functions*/
 	busw = this->options & NAND_BUSWIDTH_16;
@@ -2351,6 +2558,14 @@ int nand_scan (struct mtd_info *mtd, int maxchips)
 		this->block_bad = nand_block_bad;
 	if (!this->block_markbad)
 		this->block_markbad = nand_default_block_markbad;
+	if ((this->options & NAND_WORD_IO) || this->dma_xfer) {
+		if (!this->write_buf)
+			this->write_buf = nand_write_buf_fast;
+		if (!this->read_buf)
+			this->read_buf = nand_read_buf_fast;
+		if (!this->verify_buf)
+			this->verify_buf = nand_verify_buf_fast;
+	}
 	if (!this->write_buf)
 		this->write_buf = busw ? nand_write_buf16 : nand_write_buf;
 	if (!this->read_buf)
@@ -2514,6 +2729,17 @@ int nand_scan (struct mtd_info *mtd, int maxchips)
 	/* Preset the internal oob buffer */
 	memset(this->oob_buf, 0xff, mtd->oobsize << (this->phys_erase_shift - this->page_shift));
 
+#ifdef CONFIG_NAND_ECC_BCH
+	/* BCH brings its own placement unless the board gave one */
+	if (this->eccmode == NAND_ECC_SOFT_BCH) {
+		bchbytes = nand_bch_init(mtd);
+		if (bchbytes < 0) {
+			printk (KERN_WARNING "BCH ECC not possible on this chip, fallback to SW ECC\n");
+			this->eccmode = NAND_ECC_SOFT;
+		}
+	}
+#endif
+
 	/* If no default placement scheme is given, select an
 	 * appropriate one */
 	if (!this->autooob) {
@@ -2590,6 +2816,24 @@ int nand_scan (struct mtd_info *mtd, int maxchips)
 		this->correct_data = nand_correct_data;
 		break;
 
+	case NAND_ECC_SOFT_512:
+		if (mtd->oobblock == 256) {
+			printk (KERN_WARNING "512 byte SW ECC not possible on 256 Byte pagesize, fallback to 256 byte SW ECC \n");
+			this->eccmode = NAND_ECC_SOFT;
+		} else
+			this->eccsize = 512;
+		this->calculate_ecc = nand_calculate_ecc;
+		this->correct_data = nand_correct_data;
+		break;
+
+#ifdef CONFIG_NAND_ECC_BCH
+	case NAND_ECC_SOFT_BCH:
+		/* nand_bch_init() has set up the ECC functions */
+		this->eccsize = 512;
+		this->eccbytes = bchbytes;
+		break;
+#endif
+
 	default:
 		printk (KERN_WARNING "Invalid NAND_ECC_MODE %d\n", this->eccmode);
 /*		BUG(); */
@@ -2623,6 +2867,8 @@ int nand_scan (struct mtd_info *mtd, int maxchips)
 	case NAND_ECC_HW3_512:
 	case NAND_ECC_HW6_512:
 	case NAND_ECC_HW8_512:
+	case NAND_ECC_SOFT_512:
+	case NAND_ECC_SOFT_BCH:
 		this->eccsteps = mtd->oobblock / 512;
 		break;
 	case NAND_ECC_HW3_256:
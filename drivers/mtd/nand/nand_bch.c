@@ -0,0 +1,200 @@
+/*
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * BCH software ECC for NAND_ECC_SOFT_BCH: CFG_NAND_BCH_T correctable
+ * bit errors per 512 bytes, using the codec in lib_generic/bch.c over
+ * GF(2^13). t = 4 takes 7 ECC bytes per 512 bytes, t = 8 takes 13.
+ */
+
+#include <common.h>
+
+#if defined(CONFIG_CMD_NAND) && !defined(CFG_NAND_LEGACY) && \
+    defined(CONFIG_NAND_ECC_BCH)
+
+#include <malloc.h>
+#include <bch.h>
+#include <linux/mtd/compat.h>
+#include <linux/mtd/mtd.h>
+#include <linux/mtd/nand.h>
+#include <linux/mtd/nand_ecc.h>
+
+#ifndef CFG_NAND_BCH_T
+#define CFG_NAND_BCH_T	4
+#endif
+#if CFG_NAND_BCH_T < 1 || CFG_NAND_BCH_T > BCH_MAX_T
+#error "CFG_NAND_BCH_T out of range"
+#endif
+
+#define NAND_BCH_M		13
+#define NAND_BCH_BLOCK		512
+
+static struct bch_control *nand_bch;
+
+/*
+ * XORed into every ECC, so that the ECC of an erased (all 0xff) block
+ * is all 0xff as well and erased pages read back without errors.
+ */
+static u_char nand_bch_mask[(BCH_MAX_M * BCH_MAX_T + 7) / 8];
+
+static struct nand_oobinfo nand_bch_oob;
+
+/*
+ * Default placement: ECC bytes at the end of the OOB area, clear of
+ * the bad block marker, everything else free.
+ */
+static int nand_bch_layout(struct mtd_info *mtd, int eccbytes)
+{
+	struct nand_chip *this = mtd->priv;
+	struct nand_oobinfo *oob = &nand_bch_oob;
+	int pos, i, n, nfree;
+	u_char used[NAND_MAX_OOBSIZE];
+
+	if (eccbytes > ARRAY_SIZE(oob->eccpos) || mtd->oobsize > NAND_MAX_OOBSIZE)
+		return -1;
+
+	memset(used, 0, sizeof(used));
+	used[this->badblockpos] = 1;
+	if (this->badblockpos == NAND_LARGE_BADBLOCK_POS)
+		used[this->badblockpos + 1] = 1;
+
+	memset(oob, 0, sizeof(*oob));
+	oob->useecc = MTD_NANDECC_AUTOPLACE;
+	oob->eccbytes = eccbytes;
+	for (pos = mtd->oobsize - 1, n = eccbytes; n && pos >= 0; pos--) {
+		if (used[pos])
+			continue;
+		used[pos] = 1;
+		oob->eccpos[--n] = pos;
+	}
+	if (n)
+		return -1;
+
+	nfree = 0;
+	for (pos = 0; pos < mtd->oobsize; pos = i) {
+		for (; pos < mtd->oobsize && used[pos]; pos++)
+			;
+		for (i = pos; i < mtd->oobsize && !used[i]; i++)
+			;
+		if (i > pos && nfree < ARRAY_SIZE(oob->oobfree) - 1) {
+			oob->oobfree[nfree][0] = pos;
+			oob->oobfree[nfree][1] = i - pos;
+			nfree++;
+		}
+	}
+
+	this->autooob = oob;
+	return 0;
+}
+
+/**
+ * nand_bch_init - [NAND Interface] Set up BCH ECC for a chip
+ * @mtd:	MTD block structure
+ *
+ * Builds the codec tables on first use and, unless the board gave
+ * one, the OOB placement. Returns the ECC bytes per 512 byte block,
+ * or -1 if BCH ECC is not possible on this chip.
+ */
+int nand_bch_init(struct mtd_info *mtd)
+{
+	struct nand_chip *this = mtd->priv;
+	u_char *erased;
+	int i, steps;
+
+	if (mtd->oobblock < NAND_BCH_BLOCK)
+		return -1;
+
+	if (nand_bch == NULL) {
+		nand_bch = init_bch(NAND_BCH_M, CFG_NAND_BCH_T);
+		if (nand_bch == NULL)
+			return -1;
+
+		erased = malloc(NAND_BCH_BLOCK);
+		if (erased == NULL)
+			return -1;
+		memset(erased, 0xff, NAND_BCH_BLOCK);
+		encode_bch(nand_bch, erased, NAND_BCH_BLOCK, nand_bch_mask);
+		for (i = 0; i < nand_bch->ecc_bytes; i++)
+			nand_bch_mask[i] ^= 0xff;
+		free(erased);
+	}
+
+	steps = mtd->oobblock / NAND_BCH_BLOCK;
+	if (steps * nand_bch->ecc_bytes > NAND_MAX_OOBSIZE)
+		return -1;
+	if (!this->autooob && nand_bch_layout(mtd, steps * nand_bch->ecc_bytes))
+		return -1;
+
+	this->calculate_ecc = nand_bch_calculate_ecc;
+	this->correct_data = nand_bch_correct_data;
+
+	return nand_bch->ecc_bytes;
+}
+
+/**
+ * nand_bch_calculate_ecc - [NAND Interface] Calculate BCH ECC for 512-byte block
+ * @mtd:	MTD block structure
+ * @dat:	raw data
+ * @ecc_code:	buffer for ECC
+ */
+int nand_bch_calculate_ecc(struct mtd_info *mtd, const u_char *dat,
+			   u_char *ecc_code)
+{
+	int i;
+
+	encode_bch(nand_bch, dat, NAND_BCH_BLOCK, ecc_code);
+	for (i = 0; i < nand_bch->ecc_bytes; i++)
+		ecc_code[i] ^= nand_bch_mask[i];
+
+	return 0;
+}
+
+/**
+ * nand_bch_correct_data - [NAND Interface] Detect and correct bit errors
+ * @mtd:	MTD block structure
+ * @dat:	raw data read from the chip
+ * @read_ecc:	ECC from the chip
+ * @calc_ecc:	the ECC calculated from raw data
+ *
+ * Returns the number of corrected bit errors or -1.
+ */
+int nand_bch_correct_data(struct mtd_info *mtd, u_char *dat,
+			  u_char *read_ecc, u_char *calc_ecc)
+{
+	unsigned int errloc[BCH_MAX_T];
+	int i, n;
+
+	/* the mask cancels out */
+	n = decode_bch(nand_bch, dat, NAND_BCH_BLOCK, read_ecc, calc_ecc,
+		       errloc);
+	if (n < 0) {
+		MTDDEBUG(MTD_DEBUG_LEVEL0, "nand_bch_correct_data: "
+			 "uncorrectable error\n");
+		return -1;
+	}
+
+	for (i = 0; i < n; i++)
+		if (errloc[i] < NAND_BCH_BLOCK * 8)
+			dat[errloc[i] >> 3] ^= 1 << (errloc[i] & 7);
+
+	return n;
+}
+
+#endif
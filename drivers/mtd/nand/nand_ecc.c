@@ -35,11 +35,31 @@
  * this file might be covered by the GNU General Public License.
  */
 
+#ifndef USE_HOSTCC
 #include <common.h>
+#else
+/* tools/nand_ecc_test builds this file on the host */
+#include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+typedef uint16_t u16;
+#define CONFIG_CMD_NAND
+#endif /* USE_HOSTCC */
 
 #if defined(CONFIG_CMD_NAND) && !defined(CFG_NAND_LEGACY)
 
 #include<linux/mtd/mtd.h>
+#include<linux/mtd/nand.h>
+
+/*
+ * Number of 256 byte units per ECC step: 2 for NAND_ECC_SOFT_512
+ */
+static inline int nand_ecc_steps(struct mtd_info *mtd)
+{
+	struct nand_chip *this = mtd ? mtd->priv : NULL;
+
+	return (this && this->eccmode == NAND_ECC_SOFT_512) ? 2 : 1;
+}
 
 /*
  * NAND-SPL has no sofware ECC for now, so don't include nand_calculate_ecc(),
@@ -48,83 +68,121 @@
 
 #ifndef CONFIG_NAND_SPL
 /*
- * Pre-calculated 256-way 1 byte column parity
+ * Parity of a 32 bit word
  */
-static const u_char nand_ecc_precalc_table[] = {
-	0x00, 0x55, 0x56, 0x03, 0x59, 0x0c, 0x0f, 0x5a, 0x5a, 0x0f, 0x0c, 0x59, 0x03, 0x56, 0x55, 0x00,
-	0x65, 0x30, 0x33, 0x66, 0x3c, 0x69, 0x6a, 0x3f, 0x3f, 0x6a, 0x69, 0x3c, 0x66, 0x33, 0x30, 0x65,
-	0x66, 0x33, 0x30, 0x65, 0x3f, 0x6a, 0x69, 0x3c, 0x3c, 0x69, 0x6a, 0x3f, 0x65, 0x30, 0x33, 0x66,
-	0x03, 0x56, 0x55, 0x00, 0x5a, 0x0f, 0x0c, 0x59, 0x59, 0x0c, 0x0f, 0x5a, 0x00, 0x55, 0x56, 0x03,
-	0x69, 0x3c, 0x3f, 0x6a, 0x30, 0x65, 0x66, 0x33, 0x33, 0x66, 0x65, 0x30, 0x6a, 0x3f, 0x3c, 0x69,
-	0x0c, 0x59, 0x5a, 0x0f, 0x55, 0x00, 0x03, 0x56, 0x56, 0x03, 0x00, 0x55, 0x0f, 0x5a, 0x59, 0x0c,
-	0x0f, 0x5a, 0x59, 0x0c, 0x56, 0x03, 0x00, 0x55, 0x55, 0x00, 0x03, 0x56, 0x0c, 0x59, 0x5a, 0x0f,
-	0x6a, 0x3f, 0x3c, 0x69, 0x33, 0x66, 0x65, 0x30, 0x30, 0x65, 0x66, 0x33, 0x69, 0x3c, 0x3f, 0x6a,
-	0x6a, 0x3f, 0x3c, 0x69, 0x33, 0x66, 0x65, 0x30, 0x30, 0x65, 0x66, 0x33, 0x69, 0x3c, 0x3f, 0x6a,
-	0x0f, 0x5a, 0x59, 0x0c, 0x56, 0x03, 0x00, 0x55, 0x55, 0x00, 0x03, 0x56, 0x0c, 0x59, 0x5a, 0x0f,
-	0x0c, 0x59, 0x5a, 0x0f, 0x55, 0x00, 0x03, 0x56, 0x56, 0x03, 0x00, 0x55, 0x0f, 0x5a, 0x59, 0x0c,
-	0x69, 0x3c, 0x3f, 0x6a, 0x30, 0x65, 0x66, 0x33, 0x33, 0x66, 0x65, 0x30, 0x6a, 0x3f, 0x3c, 0x69,
-	0x03, 0x56, 0x55, 0x00, 0x5a, 0x0f, 0x0c, 0x59, 0x59, 0x0c, 0x0f, 0x5a, 0x00, 0x55, 0x56, 0x03,
-	0x66, 0x33, 0x30, 0x65, 0x3f, 0x6a, 0x69, 0x3c, 0x3c, 0x69, 0x6a, 0x3f, 0x65, 0x30, 0x33, 0x66,
-	0x65, 0x30, 0x33, 0x66, 0x3c, 0x69, 0x6a, 0x3f, 0x3f, 0x6a, 0x69, 0x3c, 0x66, 0x33, 0x30, 0x65,
-	0x00, 0x55, 0x56, 0x03, 0x59, 0x0c, 0x0f, 0x5a, 0x5a, 0x0f, 0x0c, 0x59, 0x03, 0x56, 0x55, 0x00
-};
+static inline uint32_t nand_parity(uint32_t x)
+{
+	x ^= x >> 16;
+	x ^= x >> 8;
+	x ^= x >> 4;
+	return (0x6996 >> (x & 0x0f)) & 1;
+}
 
-/**
- * nand_calculate_ecc - [NAND Interface] Calculate 3-byte ECC for 256-byte block
- * @mtd:	MTD block structure
- * @dat:	raw data
- * @ecc_code:	buffer for ECC
+/*
+ * Hamming ECC over 256 or 512 bytes, a 32 bit word at a time.
+ *
+ * Line parity bit 2k+1 is the parity of all bytes whose offset has bit
+ * k set, bit 2k that of the others. For k >= 2 that is bit k-2 of the
+ * word index, so the words are XORed into one accumulator per word
+ * index bit; bits 0 and 1 come from the bytes of the XOR of all words,
+ * which also gives the column parity. @dat must be word aligned.
  */
-int nand_calculate_ecc(struct mtd_info *mtd, const u_char *dat,
-		       u_char *ecc_code)
+static void nand_calculate_ecc_words(const uint32_t *dat, int steps,
+				     u_char *ecc_code)
 {
-	uint8_t idx, reg1, reg2, reg3, tmp1, tmp2;
+	uint32_t par = 0, rp0 = 0, rp1 = 0, rp2 = 0, rp3 = 0;
+	uint32_t rp4 = 0, rp5 = 0, rp6 = 0;
+	uint32_t s0, s1, s2, s3, s4, s5, s6, s7, odd, all, line, pp;
+	uint8_t bytes[4], col, cp;
 	int i;
 
-	/* Initialize variables */
-	reg1 = reg2 = reg3 = 0;
-
-	/* Build up column parity */
-	for(i = 0; i < 256; i++) {
-		/* Get CP0 - CP5 from table */
-		idx = nand_ecc_precalc_table[*dat++];
-		reg1 ^= (idx & 0x3f);
+	/* 16 words (64 bytes) per round */
+	for (i = 0; i < steps * 4; i++, dat += 16) {
+		s0 = dat[0] ^ dat[1];
+		s1 = dat[2] ^ dat[3];
+		s2 = dat[4] ^ dat[5];
+		s3 = dat[6] ^ dat[7];
+		s4 = dat[8] ^ dat[9];
+		s5 = dat[10] ^ dat[11];
+		s6 = dat[12] ^ dat[13];
+		s7 = dat[14] ^ dat[15];
+		odd = dat[1] ^ dat[3] ^ dat[5] ^ dat[7] ^
+		      dat[9] ^ dat[11] ^ dat[13] ^ dat[15];
+		all = s0 ^ s1 ^ s2 ^ s3 ^ s4 ^ s5 ^ s6 ^ s7;
 
-		/* All bit XOR = 1 ? */
-		if (idx & 0x40) {
-			reg3 ^= (uint8_t) i;
-			reg2 ^= ~((uint8_t) i);
-		}
+		rp0 ^= odd;
+		rp1 ^= s1 ^ s3 ^ s5 ^ s7;
+		rp2 ^= s2 ^ s3 ^ s6 ^ s7;
+		rp3 ^= s4 ^ s5 ^ s6 ^ s7;
+		if (i & 1)
+			rp4 ^= all;
+		if (i & 2)
+			rp5 ^= all;
+		if (i & 4)
+			rp6 ^= all;
+		par ^= all;
 	}
 
-	/* Create non-inverted ECC code from line parity */
-	tmp1  = (reg3 & 0x80) >> 0; /* B7 -> B7 */
-	tmp1 |= (reg2 & 0x80) >> 1; /* B7 -> B6 */
-	tmp1 |= (reg3 & 0x40) >> 1; /* B6 -> B5 */
-	tmp1 |= (reg2 & 0x40) >> 2; /* B6 -> B4 */
-	tmp1 |= (reg3 & 0x20) >> 2; /* B5 -> B3 */
-	tmp1 |= (reg2 & 0x20) >> 3; /* B5 -> B2 */
-	tmp1 |= (reg3 & 0x10) >> 3; /* B4 -> B1 */
-	tmp1 |= (reg2 & 0x10) >> 4; /* B4 -> B0 */
-
-	tmp2  = (reg3 & 0x08) << 4; /* B3 -> B7 */
-	tmp2 |= (reg2 & 0x08) << 3; /* B3 -> B6 */
-	tmp2 |= (reg3 & 0x04) << 3; /* B2 -> B5 */
-	tmp2 |= (reg2 & 0x04) << 2; /* B2 -> B4 */
-	tmp2 |= (reg3 & 0x02) << 2; /* B1 -> B3 */
-	tmp2 |= (reg2 & 0x02) << 1; /* B1 -> B2 */
-	tmp2 |= (reg3 & 0x01) << 1; /* B0 -> B1 */
-	tmp2 |= (reg2 & 0x01) << 0; /* B7 -> B0 */
+	/* Byte offset bits 0 and 1, in memory order of the bytes */
+	memcpy(bytes, &par, 4);
+	pp = nand_parity(par);
+	line  = nand_parity(bytes[0] ^ bytes[2]) << 0;
+	line |= nand_parity(bytes[1] ^ bytes[3]) << 1;
+	line |= nand_parity(bytes[0] ^ bytes[1]) << 2;
+	line |= nand_parity(bytes[2] ^ bytes[3]) << 3;
+
+	/* Byte offset bits 2 to 7, and 8 for 512 byte steps */
+	line |= (nand_parity(rp0) << 5) | ((pp ^ nand_parity(rp0)) << 4);
+	line |= (nand_parity(rp1) << 7) | ((pp ^ nand_parity(rp1)) << 6);
+	line |= (nand_parity(rp2) << 9) | ((pp ^ nand_parity(rp2)) << 8);
+	line |= (nand_parity(rp3) << 11) | ((pp ^ nand_parity(rp3)) << 10);
+	line |= (nand_parity(rp4) << 13) | ((pp ^ nand_parity(rp4)) << 12);
+	line |= (nand_parity(rp5) << 15) | ((pp ^ nand_parity(rp5)) << 14);
+	if (steps == 2)
+		line |= (nand_parity(rp6) << 17) |
+			((pp ^ nand_parity(rp6)) << 16);
+
+	/* Column parity */
+	col = bytes[0] ^ bytes[1] ^ bytes[2] ^ bytes[3];
+	cp  = nand_parity(col & 0x55) << 0;
+	cp |= nand_parity(col & 0xaa) << 1;
+	cp |= nand_parity(col & 0x33) << 2;
+	cp |= nand_parity(col & 0xcc) << 3;
+	cp |= nand_parity(col & 0x0f) << 4;
+	cp |= nand_parity(col & 0xf0) << 5;
 
 	/* Calculate final ECC code */
 #ifdef CONFIG_MTD_NAND_ECC_SMC
-	ecc_code[0] = ~tmp2;
-	ecc_code[1] = ~tmp1;
+	ecc_code[0] = ~line;
+	ecc_code[1] = ~(line >> 8);
 #else
-	ecc_code[0] = ~tmp1;
-	ecc_code[1] = ~tmp2;
+	ecc_code[0] = ~(line >> 8);
+	ecc_code[1] = ~line;
 #endif
-	ecc_code[2] = ((~reg1) << 2) | 0x03;
+	/* the two low bits stay ones for 256 byte steps */
+	ecc_code[2] = ~((cp << 2) | ((line >> 16) & 0x03));
+}
+
+/**
+ * nand_calculate_ecc - [NAND Interface] Calculate 3-byte ECC for 256-byte block
+ * @mtd:	MTD block structure
+ * @dat:	raw data
+ * @ecc_code:	buffer for ECC
+ *
+ * With NAND_ECC_SOFT_512 the block is 512 bytes, and the two low bits
+ * of the third byte hold the line parity of byte offset bit 8.
+ */
+int nand_calculate_ecc(struct mtd_info *mtd, const u_char *dat,
+		       u_char *ecc_code)
+{
+	int steps = nand_ecc_steps(mtd);
+	uint32_t buf[512 / 4];
+
+	if ((unsigned long)dat & 3) {
+		memcpy(buf, dat, steps * 256);
+		dat = (const u_char *)buf;
+	}
+	nand_calculate_ecc_words((const uint32_t *)dat, steps, ecc_code);
 
 	return 0;
 }
@@ -146,12 +204,15 @@ static inline int countbits(uint32_t byte)
  * @read_ecc:	ECC from the chip
  * @calc_ecc:	the ECC calculated from raw data
  *
- * Detect and correct a 1 bit error for 256 byte block
+ * Detect and correct a 1 bit error for 256 byte block (512 bytes with
+ * NAND_ECC_SOFT_512)
  */
 int nand_correct_data(struct mtd_info *mtd, u_char *dat,
 		      u_char *read_ecc, u_char *calc_ecc)
 {
-	uint8_t s0, s1, s2;
+	uint8_t s0, s1, s2, s2mask;
+
+	s2mask = nand_ecc_steps(mtd) == 2 ? 0x55 : 0x54;
 
 #ifdef CONFIG_MTD_NAND_ECC_SMC
 	s0 = calc_ecc[0] ^ read_ecc[0];
@@ -168,7 +229,7 @@ int nand_correct_data(struct mtd_info *mtd, u_char *dat,
 	/* Check for a single bit error */
 	if( ((s0 ^ (s0 >> 1)) & 0x55) == 0x55 &&
 	    ((s1 ^ (s1 >> 1)) & 0x55) == 0x55 &&
-	    ((s2 ^ (s2 >> 1)) & 0x54) == 0x54) {
+	    ((s2 ^ (s2 >> 1)) & s2mask) == s2mask) {
 
 		uint32_t byteoffs, bitnum;
 
@@ -182,6 +243,8 @@ int nand_correct_data(struct mtd_info *mtd, u_char *dat,
 		byteoffs |= (s0 >> 2) & 0x02;
 		byteoffs |= (s0 >> 1) & 0x01;
 
+		byteoffs |= (s2 << 7) & 0x100;
+
 		bitnum = (s2 >> 5) & 0x04;
 		bitnum |= (s2 >> 4) & 0x02;
 		bitnum |= (s2 >> 3) & 0x01;
@@ -526,6 +526,188 @@ restoreoob:
 	return 0;
 }
 
+/*
+ * One bad block check: straight from the in-RAM BBT if there is one
+ * (any non-zero entry, reserved BBT blocks included, is skipped),
+ * otherwise through the driver.
+ */
+static int nand_stream_isbad(nand_info_t *nand, ulong offs)
+{
+	struct nand_chip *this = nand->priv;
+	int block;
+
+	if (this->bbt == NULL)
+		return nand->block_isbad(nand, offs);
+
+	block = offs >> this->bbt_erase_shift;
+	return (this->bbt[block >> 2] >> ((block & 3) << 1)) & 0x03 ? 1 : 0;
+}
+
+/* Extend the block map up to entry idx, returns 0 if it is there */
+static int nand_stream_map(nand_stream_t *s, int idx)
+{
+	int ret;
+
+	while (s->nmap <= idx) {
+		if (s->next >= s->end)
+			return -1;
+
+		ret = nand_stream_isbad(s->nand, s->next);
+		if (ret < 0) {
+			printf("Bad block check failed\n");
+			return -1;
+		}
+		if (ret == 0)
+			s->map[s->nmap++] = s->next;
+		else if (!s->quiet)
+			printf("\rBad block at 0x%lx will be skipped\n",
+			       s->next);
+		s->next += s->nand->erasesize;
+	}
+
+	return 0;
+}
+
+/**
+ * nand_stream_open: - prepare sequential reading of a NAND range
+ *
+ * @param s		stream to set up
+ * @param nand		NAND device
+ * @param start		first byte to read
+ * @param end		end of the range (partition or device end)
+ * @param quiet		don't report skipped bad blocks
+ * @return		0 in case of success
+ *
+ * The block map is filled as the stream advances, so only the blocks
+ * actually read are looked up, each of them once.
+ */
+int nand_stream_open(nand_stream_t *s, nand_info_t *nand, ulong start,
+		     ulong end, int quiet)
+{
+	memset(s, 0, sizeof(*s));
+
+	if (end > nand->size)
+		end = nand->size;
+	if (start >= end)
+		return -1;
+
+	s->nand = nand;
+	s->skip = start & (nand->erasesize - 1);
+	s->start = s->next = start - s->skip;
+	s->end = end;
+	s->quiet = quiet;
+	s->maxmap = (end - s->start + nand->erasesize - 1) / nand->erasesize;
+
+	s->map = malloc(s->maxmap * sizeof(ulong));
+	if (s->map == NULL) {
+		printf("No memory for the NAND block map\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * nand_stream_read: - read the next len bytes, skipping bad blocks
+ *
+ * @param s		stream from nand_stream_open()
+ * @param buf		destination
+ * @param len		number of bytes
+ * @return		0 in case of success
+ */
+int nand_stream_read(nand_stream_t *s, u_char *buf, ulong len)
+{
+	nand_info_t *nand = s->nand;
+	ulong pos, offs, chunk;
+	size_t retlen;
+	int i, j;
+
+	while (len) {
+		WATCHDOG_RESET();
+
+		pos = s->pos + s->skip;
+		i = pos / nand->erasesize;
+		offs = pos % nand->erasesize;
+		if (nand_stream_map(s, i))
+			goto short_read;
+
+		/* merge physically contiguous good blocks into one read */
+		chunk = nand->erasesize - offs;
+		for (j = i; chunk < len; j++) {
+			if (nand_stream_map(s, j + 1) ||
+			    s->map[j + 1] != s->map[j] + nand->erasesize)
+				break;
+			chunk += nand->erasesize;
+		}
+		if (chunk > len)
+			chunk = len;
+
+		if (nand->read(nand, s->map[i] + offs, chunk, &retlen, buf) ||
+		    retlen != chunk) {
+			printf("reading NAND at offset 0x%lx failed\n",
+			       s->map[i] + offs);
+			return -1;
+		}
+
+		buf += chunk;
+		len -= chunk;
+		s->pos += chunk;
+	}
+
+	return 0;
+
+short_read:
+	printf("Could not read entire image due to bad blocks\n");
+	return -1;
+}
+
+void nand_stream_close(nand_stream_t *s)
+{
+	free(s->map);
+	s->map = NULL;
+}
+
+/*
+ * nand_read_opts() without OOB data: through a NAND stream, in erase
+ * block steps for the progress display or all at once if quiet.
+ */
+static int nand_read_stream_opts(nand_info_t *meminfo,
+				 const nand_read_options_t *opts)
+{
+	nand_stream_t s;
+	ulong done, chunk;
+	int ret = 0;
+
+	if (nand_stream_open(&s, meminfo, opts->offset, meminfo->size,
+			     opts->quiet))
+		return -1;
+
+	if (!opts->quiet)
+		printf("\n");
+
+	for (done = 0; done < opts->length; done += chunk) {
+		chunk = opts->length - done;
+		if (!opts->quiet) {
+			unsigned long long n = (unsigned long long)done * 100;
+
+			do_div(n, opts->length);
+			if (chunk > meminfo->erasesize)
+				chunk = meminfo->erasesize;
+			printf("\rReading data from 0x%lx -- %3d%% complete.",
+			       opts->offset + done, (int)n);
+		}
+		ret = nand_stream_read(&s, opts->buffer + done, chunk);
+		if (ret)
+			break;
+	}
+
+	if (!opts->quiet)
+		printf("\n");
+
+	nand_stream_close(&s);
+	return ret;
+}
+
 /**
  * nand_read_opts: - read image from NAND flash with support for various options
  *
@@ -547,6 +729,9 @@ int nand_read_opts(nand_info_t *meminfo, const nand_read_options_t *opts)
 	u_char *buffer = opts->buffer;
 	int result;
 
+	if (!opts->readoob)
+		return nand_read_stream_opts(meminfo, opts);
+
 	/* make sure device page sizes are valid */
 	if (!(meminfo->oobsize == 16 && meminfo->oobblock == 512)
 	    && !(meminfo->oobsize == 8 && meminfo->oobblock == 256)
@@ -1064,41 +1064,31 @@ static int smc_open(bd_t *bd)
 
 /*-------------------------------------------------------------
  .
- . smc_rcv -  receive a packet from the card
+ . smc_rcv_frame -  read one packet from the card into buf
  .
- . There is ( at least ) a packet waiting to be read from
- . chip-memory.
+ . The caller has selected bank 2 and saved PNR and PTR.
  .
  . o Read the status
  . o If an error, record it
  . o otherwise, read in the packet
+ . o Release the packet's chip memory
+ .
+ . Returns the packet length, 0 for a bad packet or -1 when the
+ . RX FIFO is empty.
  --------------------------------------------------------------
 */
-static int smc_rcv(void)
+static int smc_rcv_frame(volatile uchar *buf)
 {
         int     packet_number;
         word    status;
         word    packet_length;
 	int	is_error = 0;
-	byte saved_pnr;
-	word saved_ptr;
-
-        /* assume bank 2 */
-	SMC_SELECT_BANK(2);
-	/* save PTR and PTR registers */
-	saved_pnr = SMC_inb( PN_REG );
-	saved_ptr = SMC_inw( PTR_REG );
-
 
         packet_number = SMC_inw(   RXFIFO_REG );
 
         if ( packet_number & RXFIFO_REMPTY ) {
-
-                /* we got called , but nothing was on the FIFO */
-                PRINTK("%s: WARNING: smc_rcv with nothing on FIFO. \n",
-                        CARDNAME);
-                /* don't need to restore anything */
-                return 0;
+                /* nothing (more) on the FIFO */
+                return -1;
         }
 
         PRINTK3("%s:smc_rcv\n", CARDNAME);
@@ -1125,12 +1115,12 @@ static int smc_rcv(void)
                    to send the DWORDs or the bytes first, or some
                    mixture.  A mixture might improve already slow PIO
                    performance  */
-		SMC_insl( DATA_REG , NetRxPackets[0], packet_length >> 2 );
+		SMC_insl( DATA_REG , buf, packet_length >> 2 );
                 /* read the left over bytes */
 		if (packet_length & 3) {
 			int i;
 
-			byte *tail = (byte *)(NetRxPackets[0] + (packet_length & ~3));
+			byte *tail = (byte *)(buf + (packet_length & ~3));
 			dword leftover = SMC_inl(DATA_REG);
 			for (i=0; i<(packet_length & 3); i++)
 				*tail++ = (byte) (leftover >> (8*i)) & 0xff;
@@ -1138,13 +1128,13 @@ static int smc_rcv(void)
 #else
                 PRINTK3(" Reading %d words and %d byte(s) \n",
                         (packet_length >> 1 ), packet_length & 1 );
-		SMC_insw(DATA_REG , NetRxPackets[0], packet_length >> 1);
+		SMC_insw(DATA_REG , buf, packet_length >> 1);
 
 #endif // USE_32_BIT
 
 #if SMC_DEBUG > 2
 		printf("Receiving Packet\n");
-		print_packet( NetRxPackets, packet_length );
+		print_packet( (byte *)buf, packet_length );
 #endif
         } else {
                 /* error ... */
@@ -1159,18 +1149,56 @@ static int smc_rcv(void)
 	while ( SMC_inw( MMU_CMD_REG ) & MC_BUSY )
 		udelay(1); /* Wait until not busy */
 
+	return is_error ? 0 : packet_length;
+}
+
+/*-------------------------------------------------------------
+ .
+ . smc_rcv -  receive packets from the card
+ .
+ . With CONFIG_SMC_RX_BURST every packet waiting in the RX FIFO (up to
+ . PKTBUFSRX, see CFG_RX_ETH_BUFFER) is copied into the NetRxPackets
+ . ring first, which frees the chip memory as fast as possible, and
+ . only then handed to NetReceive(). Otherwise one packet per call.
+ --------------------------------------------------------------
+*/
+static int smc_rcv(void)
+{
+	int	lengths[PKTBUFSRX];
+	int	count = 0;
+	int	len, i;
+	byte saved_pnr;
+	word saved_ptr;
+
+        /* assume bank 2 */
+	SMC_SELECT_BANK(2);
+	/* save PTR and PTR registers */
+	saved_pnr = SMC_inb( PN_REG );
+	saved_ptr = SMC_inw( PTR_REG );
+
+#ifdef CONFIG_SMC_RX_BURST
+	while (count < PKTBUFSRX &&
+	       (len = smc_rcv_frame(NetRxPackets[count])) >= 0) {
+		if (len > 0)
+			lengths[count++] = len;
+	}
+#else
+	if ((len = smc_rcv_frame(NetRxPackets[0])) > 0)
+		lengths[count++] = len;
+#endif
+
 	/* restore saved registers */
 	SMC_outb( saved_pnr, PN_REG );
 
 	SMC_outw( saved_ptr, PTR_REG );
 
-	if (!is_error) {
-		/* Pass the packet up to the protocol layers. */
-		NetReceive(NetRxPackets[0], packet_length);
-		return packet_length;
-	} else {
-		return 0;
+	/* Pass the packets up to the protocol layers. */
+	len = 0;
+	for (i = 0; i < count; i++) {
+		NetReceive(NetRxPackets[i], lengths[i]);
+		len += lengths[i];
 	}
+	return len;
 }
 
 
@@ -47,9 +47,117 @@ struct cramfs_super super;
 extern flash_info_t flash_info[];
 #define PART_OFFSET(x)	(x->offset + flash_info[x->dev->id->num].start[0])
 
+/* Number of path components remembered by cramfs_resolve() */
+#ifndef CFG_CRAMFS_DCACHE_SIZE
+#define CFG_CRAMFS_DCACHE_SIZE	16
+#endif
+#define CRAMFS_DCACHE_NAMELEN	64
+
+typedef struct {
+	unsigned long	dir;		/* Offset of the directory data */
+	unsigned long	inode;		/* Offset of the matching inode */
+	char		name[CRAMFS_DCACHE_NAMELEN];
+} cramfs_dcache_ent;
+
+static cramfs_dcache_ent cramfs_dcache[CFG_CRAMFS_DCACHE_SIZE];
+static int cramfs_dcache_next;
+
+/* The image the dentry cache and the CRC check result belong to */
+static unsigned long cramfs_cur_begin = ~0UL;
+static struct cramfs_info cramfs_cur_fsid;
+static u32 cramfs_cur_size;
+static int cramfs_crc_ok;
+
+#define CRAMFS_CRC_CHUNK	(64 * 1024)
+
+/*
+ * Flush the dentry cache and forget the CRC check result when the
+ * superblock just read is not the one they were built from.
+ */
+static void cramfs_cur_check (struct part_info *info)
+{
+	if (cramfs_cur_begin == PART_OFFSET(info) &&
+	    cramfs_cur_size == super.size &&
+	    !memcmp (&cramfs_cur_fsid, &super.fsid, sizeof (super.fsid)))
+		return;
+
+	memset (cramfs_dcache, 0, sizeof (cramfs_dcache));
+	cramfs_dcache_next = 0;
+	cramfs_crc_ok = 0;
+	cramfs_cur_begin = PART_OFFSET(info);
+	cramfs_cur_size = super.size;
+	memcpy (&cramfs_cur_fsid, &super.fsid, sizeof (super.fsid));
+}
+
+static unsigned long cramfs_dcache_lookup (unsigned long dir, char *name)
+{
+	int i;
+
+	if (name == NULL)
+		return 0;
+
+	for (i = 0; i < CFG_CRAMFS_DCACHE_SIZE; i++) {
+		cramfs_dcache_ent *ent = &cramfs_dcache[i];
+
+		if (ent->inode && ent->dir == dir && !strcmp (ent->name, name))
+			return ent->inode;
+	}
+	return 0;
+}
+
+static void cramfs_dcache_insert (unsigned long dir, char *name,
+				  unsigned long inode)
+{
+	cramfs_dcache_ent *ent = &cramfs_dcache[cramfs_dcache_next];
+
+	if (strlen (name) >= CRAMFS_DCACHE_NAMELEN)
+		return;
+
+	ent->dir = dir;
+	ent->inode = inode;
+	strcpy (ent->name, name);
+	cramfs_dcache_next = (cramfs_dcache_next + 1) % CFG_CRAMFS_DCACHE_SIZE;
+}
+
+/*
+ * With FSID version 2 the superblock holds the crc32 of the image from
+ * the superblock's 512 byte pad (if any) up to super.size, taken with
+ * the crc field itself as zero. Check it once per image.
+ */
+static int cramfs_check_crc (struct part_info *info, unsigned long start)
+{
+	unsigned char *base = (unsigned char *) PART_OFFSET(info) + start;
+	unsigned long crcoff = (unsigned long) &super.fsid.crc -
+			       (unsigned long) &super;
+	u32 zero = 0, crc;
+
+	if (cramfs_crc_ok)
+		return 0;
+
+	if (super.size < start + sizeof (super) || super.size > info->size) {
+		printf ("cramfs: bad image size 0x%x\n", super.size);
+		return -1;
+	}
+
+	start = super.size - start;
+	crc = crc32_wd (0, base, crcoff, CRAMFS_CRC_CHUNK);
+	crc = crc32 (crc, (unsigned char *) &zero, sizeof (zero));
+	crc = crc32_wd (crc, base + crcoff + sizeof (zero),
+			start - crcoff - sizeof (zero), CRAMFS_CRC_CHUNK);
+
+	if (crc != CRAMFS_32 (super.fsid.crc)) {
+		printf ("cramfs: bad CRC 0x%08x, expected 0x%08x\n", crc,
+			CRAMFS_32 (super.fsid.crc));
+		return -1;
+	}
+
+	cramfs_crc_ok = 1;
+	return 0;
+}
+
 static int cramfs_read_super (struct part_info *info)
 {
-	unsigned long root_offset;
+	unsigned long root_offset, start = 0;
 
 	/* Read the first block and get the superblock from it */
 	memcpy (&super, (void *) PART_OFFSET(info), sizeof (super));
@@ -57,6 +165,7 @@ static int cramfs_read_super (struct part_info *info)
 	/* Do sanity checks on the superblock */
 	if (super.magic != CRAMFS_32 (CRAMFS_MAGIC)) {
 		/* check at 512 byte offset */
+		start = 512;
 		memcpy (&super, (void *) PART_OFFSET(info) + 512, sizeof (super));
 		if (super.magic != CRAMFS_32 (CRAMFS_MAGIC)) {
 			printf ("cramfs: wrong magic\n");
@@ -89,6 +198,11 @@ static int cramfs_read_super (struct part_info *info)
 		return -1;
 	}
 
+	cramfs_cur_check (info);
+	if ((super.flags & CRAMFS_FLAG_FSID_VERSION_2) &&
+	    cramfs_check_crc (info, start))
+		return -1;
+
 	return 0;
 }
 
@@ -98,6 +212,11 @@ static unsigned long cramfs_resolve (unsigned long begin, unsigned long offset,
 {
 	unsigned long inodeoffset = 0, nextoffset;
 
+	/* Start at the entry found last time, if this name was looked up */
+	nextoffset = cramfs_dcache_lookup (offset, filename);
+	if (nextoffset)
+		inodeoffset = nextoffset - offset;
+
 	while (inodeoffset < size) {
 		struct cramfs_inode *inode;
 		char *name;
@@ -126,7 +245,11 @@ static unsigned long cramfs_resolve (unsigned long begin, unsigned long offset,
 		}
 
 		if (!strncmp (filename, name, namelen)) {
-			char *p = strtok (NULL, "/");
+			char *p;
+
+			cramfs_dcache_insert (offset, filename,
+					      offset + inodeoffset);
+			p = strtok (NULL, "/");
 
 			if (raw && (p == NULL || *p == '\0'))
 				return offset + inodeoffset;
@@ -167,13 +290,22 @@ static int cramfs_uncompress (unsigned long begin, unsigned long offset,
 	int size, total_size = 0;
 	int i;
 
-	cramfs_uncompress_init ();
+	if (cramfs_uncompress_init ())
+		return -1;
 
 	for (i = 0; i < ((CRAMFS_24 (inode->size) + 4095) >> 12); i++) {
-		size = cramfs_uncompress_block ((void *) loadoffset,
-						(void *) (begin + curr_block),
-						(CRAMFS_32 (block_ptrs[i]) -
-						 curr_block));
+		if (CRAMFS_32 (block_ptrs[i]) == curr_block &&
+		    (super.flags & CRAMFS_FLAG_HOLES)) {
+			/* an empty block is a hole */
+			size = CRAMFS_24 (inode->size) - total_size;
+			if (size > 4096)
+				size = 4096;
+			memset ((void *) loadoffset, 0, size);
+		} else
+			size = cramfs_uncompress_block ((void *) loadoffset,
+							(void *) (begin + curr_block),
+							(CRAMFS_32 (block_ptrs[i]) -
+							 curr_block));
 		if (size < 0)
 			return size;
 		loadoffset += size;
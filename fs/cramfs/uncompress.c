@@ -28,15 +28,51 @@
 #if defined(CONFIG_CMD_CRAMFS)
 
 static z_stream stream;
+static int stream_ready;
 
 void *zalloc(void *, unsigned, unsigned);
 void zfree(void *, void *, unsigned);
 
+/*
+ * mkcramfs stores a block that does not compress as a zlib stream
+ * holding one final stored deflate block: 2 bytes zlib header, the
+ * block header byte, LEN and ~LEN, the data and its adler32. Copy
+ * such blocks directly instead of running them through inflate.
+ * Returns -1 if the block is not of this form.
+ */
+static int cramfs_copy_stored (void *dst, unsigned char *src, int srclen)
+{
+	unsigned int len;
+	uLong adler;
+
+	if (srclen < 11 || (src[0] & 0x0f) != 8 /* deflate */ ||
+	    (src[1] & 0x20) || ((src[0] << 8) | src[1]) % 31 ||
+	    (src[2] & 0x07) != 0x01)
+		return -1;
+
+	len = src[3] | (src[4] << 8);
+	if ((len ^ (src[5] | (src[6] << 8))) != 0xffff ||
+	    srclen != len + 11 || len > 4096 * 2)
+		return -1;
+
+	adler = ((uLong)src[len + 7] << 24) | (src[len + 8] << 16) |
+		(src[len + 9] << 8) | src[len + 10];
+	if (adler32 (1L, src + 7, len) != adler)
+		return -1;
+
+	memcpy (dst, src + 7, len);
+	return len;
+}
+
 /* Returns length of decompressed data. */
 int cramfs_uncompress_block (void *dst, void *src, int srclen)
 {
 	int err;
 
+	err = cramfs_copy_stored (dst, src, srclen);
+	if (err >= 0)
+		return err;
+
 	inflateReset (&stream);
 
 	stream.next_in = src;
@@ -57,10 +93,18 @@ int cramfs_uncompress_block (void *dst, void *src, int srclen)
 	return -1;
 }
 
+/*
+ * The stream, with its window and tables, is set up once and reused
+ * for every block of every file; inflateReset() between blocks is
+ * all that is needed.
+ */
 int cramfs_uncompress_init (void)
 {
 	int err;
 
+	if (stream_ready)
+		return 0;
+
 	stream.zalloc = zalloc;
 	stream.zfree = zfree;
 	stream.next_in = 0;
@@ -78,12 +122,13 @@ int cramfs_uncompress_init (void)
 		return -1;
 	}
 
+	stream_ready = 1;
 	return 0;
 }
 
 int cramfs_uncompress_exit (void)
 {
-	inflateEnd (&stream);
+	/* keep the stream for the next file, see cramfs_uncompress_init() */
 	return 0;
 }
 
@@ -33,6 +33,17 @@
 static block_dev_desc_t *ext2fs_block_dev_desc;
 static disk_partition_t part_info;
 
+/* Number of block_read() calls, for debugging */
+unsigned long ext2fs_devread_cnt;
+
+static inline ulong ext2fs_block_read (int sector, ulong count, void *buf)
+{
+	ext2fs_devread_cnt++;
+	return ext2fs_block_dev_desc->block_read (ext2fs_block_dev_desc->dev,
+						  part_info.start + sector,
+						  count, (unsigned long *) buf);
+}
+
 int ext2fs_set_blk_dev (block_dev_desc_t * rbdd, int part)
 {
 	ext2fs_block_dev_desc = rbdd;
@@ -82,10 +93,7 @@ int ext2fs_devread (int sector, int byte_offset, int byte_len, char *buf) {
 
 	if (byte_offset != 0) {
 		/* read first part which isn't aligned with start of sector */
-		if (ext2fs_block_dev_desc->
-		    block_read (ext2fs_block_dev_desc->dev,
-				part_info.start + sector, 1,
-				(unsigned long *) sec_buf) != 1) {
+		if (ext2fs_block_read (sector, 1, sec_buf) != 1) {
 			printf (" ** ext2fs_devread() read error **\n");
 			return (0);
 		}
@@ -106,17 +114,12 @@ int ext2fs_devread (int sector, int byte_offset, int byte_len, char *buf) {
 		u8 p[SECTOR_SIZE];
 
 		block_len = SECTOR_SIZE;
-		ext2fs_block_dev_desc->block_read(ext2fs_block_dev_desc->dev,
-						  part_info.start + sector,
-						  1, (unsigned long *)p);
+		ext2fs_block_read (sector, 1, p);
 		memcpy(buf, p, byte_len);
 		return 1;
 	}
 
-	if (ext2fs_block_dev_desc->block_read (ext2fs_block_dev_desc->dev,
-					       part_info.start + sector,
-					       block_len / SECTOR_SIZE,
-					       (unsigned long *) buf) !=
+	if (ext2fs_block_read (sector, block_len / SECTOR_SIZE, buf) !=
 	    block_len / SECTOR_SIZE) {
 		printf (" ** ext2fs_devread() read error - block\n");
 		return (0);
@@ -128,10 +131,7 @@ int ext2fs_devread (int sector, int byte_offset, int byte_len, char *buf) {
 
 	if (byte_len != 0) {
 		/* read rest of data which are not in whole sector */
-		if (ext2fs_block_dev_desc->
-		    block_read (ext2fs_block_dev_desc->dev,
-				part_info.start + sector, 1,
-				(unsigned long *) sec_buf) != 1) {
+		if (ext2fs_block_read (sector, 1, sec_buf) != 1) {
 			printf (" ** ext2fs_devread() read error - last part\n");
 			return (0);
 		}
@@ -174,24 +174,99 @@ typedef struct ext2fs_node *ext2fs_node_t;
 struct ext2_data *ext2fs_root = NULL;
 ext2fs_node_t ext2fs_file = NULL;
 int symlinknest = 0;
-uint32_t *indir1_block = NULL;
-int indir1_size = 0;
-int indir1_blkno = -1;
-uint32_t *indir2_block = NULL;
-int indir2_size = 0;
-int indir2_blkno = -1;
+
+/*
+ * Small LRU cache of filesystem blocks, used for the group descriptors,
+ * the inode table, indirect blocks and the partial blocks read by
+ * ext2fs_read_file() (which includes all directory lookups).
+ */
+#ifndef CFG_EXT2_CACHE_BLOCKS
+#define CFG_EXT2_CACHE_BLOCKS	8
+#endif
+
+struct ext2_cache_ent {
+	int blkno;		/* filesystem block number */
+	unsigned long lru;	/* 0: unused */
+	char *buf;
+};
+
+static struct ext2_cache_ent ext2_cache[CFG_EXT2_CACHE_BLOCKS];
+static int ext2_cache_blksz = 0;
+static unsigned long ext2_cache_tick = 0;
+
+
+static void ext2fs_cache_free (void) {
+	int i;
+
+	for (i = 0; i < CFG_EXT2_CACHE_BLOCKS; i++) {
+		if (ext2_cache[i].buf != NULL) {
+			free (ext2_cache[i].buf);
+		}
+		ext2_cache[i].buf = NULL;
+		ext2_cache[i].lru = 0;
+	}
+	ext2_cache_blksz = 0;
+}
+
+
+static char *ext2fs_cache_get (struct ext2_data *data, int blkno) {
+	struct ext2_cache_ent *ent = NULL;
+	int blksz = EXT2_BLOCK_SIZE (data);
+	int i;
+
+	if (blksz != ext2_cache_blksz) {
+		ext2fs_cache_free ();
+		ext2_cache_blksz = blksz;
+	}
+
+	ext2_cache_tick++;
+	for (i = 0; i < CFG_EXT2_CACHE_BLOCKS; i++) {
+		if (ext2_cache[i].lru && ext2_cache[i].blkno == blkno) {
+			ext2_cache[i].lru = ext2_cache_tick;
+			return (ext2_cache[i].buf);
+		}
+		if (ent == NULL || ext2_cache[i].lru < ent->lru) {
+			ent = &ext2_cache[i];
+		}
+	}
+
+	/* Miss: replace the least recently used entry.  */
+	if (ent->buf == NULL) {
+		ent->buf = malloc (blksz);
+		if (ent->buf == NULL) {
+			printf ("** ext2fs block cache malloc failed. **\n");
+			return (NULL);
+		}
+	}
+	ent->lru = 0;
+	if (ext2fs_devread (blkno << LOG2_EXT2_BLOCK_SIZE (data), 0, blksz,
+			    ent->buf) == 0) {
+		printf ("** ext2fs read block %d failed. **\n", blkno);
+		return (NULL);
+	}
+	ent->blkno = blkno;
+	ent->lru = ext2_cache_tick;
+	return (ent->buf);
+}
 
 
 static int ext2fs_blockgroup
 	(struct ext2_data *data, int group, struct ext2_block_group *blkgrp) {
+	unsigned int blksz = EXT2_BLOCK_SIZE (data);
+	unsigned int off = group * sizeof (struct ext2_block_group);
+	char *blk;
+
 #ifdef DEBUG
 	printf ("ext2fs read blockgroup\n");
 #endif
-	return (ext2fs_devread
-		(((__le32_to_cpu (data->sblock.first_data_block) +
-		   1) << LOG2_EXT2_BLOCK_SIZE (data)),
-		 group * sizeof (struct ext2_block_group),
-		 sizeof (struct ext2_block_group), (char *) blkgrp));
+	blk = ext2fs_cache_get (data,
+				__le32_to_cpu (data->sblock.first_data_block) +
+				1 + off / blksz);
+	if (blk == NULL) {
+		return (0);
+	}
+	memcpy (blkgrp, blk + off % blksz, sizeof (struct ext2_block_group));
+	return (1);
 }
 
 
@@ -201,6 +276,7 @@ static int ext2fs_read_inode
 	struct ext2_sblock *sblock = &data->sblock;
 	int inodes_per_block;
 	int status;
+	char *blk;
 
 	unsigned int blkno;
 	unsigned int blkoff;
@@ -226,13 +302,12 @@ static int ext2fs_read_inode
 	printf ("ext2fs read inode blkno %d blkoff %d\n", blkno, blkoff);
 #endif
 	/* Read the inode.  */
-	status = ext2fs_devread (((__le32_to_cpu (blkgrp.inode_table_id) +
-				   blkno) << LOG2_EXT2_BLOCK_SIZE (data)),
-				 sizeof (struct ext2_inode) * blkoff,
-				 sizeof (struct ext2_inode), (char *) inode);
-	if (status == 0) {
+	blk = ext2fs_cache_get (data,
+				__le32_to_cpu (blkgrp.inode_table_id) + blkno);
+	if (blk == NULL) {
 		return (0);
 	}
+	memcpy (inode, blk + 128 * blkoff, sizeof (struct ext2_inode));
 	return (1);
 }
 
@@ -244,136 +319,57 @@ void ext2fs_free_node (ext2fs_node_t node, ext2fs_node_t currroot) {
 }
 
 
+/* Entry idx of indirect block blk; holes and errors are passed on.  */
+static int ext2fs_read_indir (struct ext2_data *data, int blk, unsigned int idx) {
+	uint32_t *indir;
+
+	if (blk <= 0) {
+		return (blk);
+	}
+	indir = (uint32_t *) ext2fs_cache_get (data, blk);
+	if (indir == NULL) {
+		return (-1);
+	}
+	return (__le32_to_cpu (indir[idx]));
+}
+
+
 static int ext2fs_read_block (ext2fs_node_t node, int fileblock) {
 	struct ext2_data *data = node->data;
 	struct ext2_inode *inode = &node->inode;
 	int blknr;
-	int blksz = EXT2_BLOCK_SIZE (data);
-	int log2_blksz = LOG2_EXT2_BLOCK_SIZE (data);
-	int status;
+	unsigned int perblock = EXT2_BLOCK_SIZE (data) / 4;
+	unsigned int rblock;
 
 	/* Direct blocks.  */
 	if (fileblock < INDIRECT_BLOCKS) {
 		blknr = __le32_to_cpu (inode->b.blocks.dir_blocks[fileblock]);
 	}
 	/* Indirect.  */
-	else if (fileblock < (INDIRECT_BLOCKS + (blksz / 4))) {
-		if (indir1_block == NULL) {
-			indir1_block = (uint32_t *) malloc (blksz);
-			if (indir1_block == NULL) {
-				printf ("** ext2fs read block (indir 1) malloc failed. **\n");
-				return (-1);
-			}
-			indir1_size = blksz;
-			indir1_blkno = -1;
-		}
-		if (blksz != indir1_size) {
-			free (indir1_block);
-			indir1_block = NULL;
-			indir1_size = 0;
-			indir1_blkno = -1;
-			indir1_block = (uint32_t *) malloc (blksz);
-			if (indir1_block == NULL) {
-				printf ("** ext2fs read block (indir 1) malloc failed. **\n");
-				return (-1);
-			}
-			indir1_size = blksz;
-		}
-		if ((__le32_to_cpu (inode->b.blocks.indir_block) <<
-		     log2_blksz) != indir1_blkno) {
-			status = ext2fs_devread (__le32_to_cpu(inode->b.blocks.indir_block) << log2_blksz,
-						 0, blksz,
-						 (char *) indir1_block);
-			if (status == 0) {
-				printf ("** ext2fs read block (indir 1) failed. **\n");
-				return (0);
-			}
-			indir1_blkno =
-				__le32_to_cpu (inode->b.blocks.
-					       indir_block) << log2_blksz;
-		}
-		blknr = __le32_to_cpu (indir1_block
-				       [fileblock - INDIRECT_BLOCKS]);
+	else if ((rblock = fileblock - INDIRECT_BLOCKS) < perblock) {
+		blknr = ext2fs_read_indir (data,
+					   __le32_to_cpu (inode->b.blocks.indir_block),
+					   rblock);
 	}
 	/* Double indirect.  */
-	else if (fileblock <
-		 (INDIRECT_BLOCKS + (blksz / 4 * (blksz / 4 + 1)))) {
-		unsigned int perblock = blksz / 4;
-		unsigned int rblock = fileblock - (INDIRECT_BLOCKS
-						   + blksz / 4);
-
-		if (indir1_block == NULL) {
-			indir1_block = (uint32_t *) malloc (blksz);
-			if (indir1_block == NULL) {
-				printf ("** ext2fs read block (indir 2 1) malloc failed. **\n");
-				return (-1);
-			}
-			indir1_size = blksz;
-			indir1_blkno = -1;
-		}
-		if (blksz != indir1_size) {
-			free (indir1_block);
-			indir1_block = NULL;
-			indir1_size = 0;
-			indir1_blkno = -1;
-			indir1_block = (uint32_t *) malloc (blksz);
-			if (indir1_block == NULL) {
-				printf ("** ext2fs read block (indir 2 1) malloc failed. **\n");
-				return (-1);
-			}
-			indir1_size = blksz;
-		}
-		if ((__le32_to_cpu (inode->b.blocks.double_indir_block) <<
-		     log2_blksz) != indir1_blkno) {
-			status = ext2fs_devread (__le32_to_cpu(inode->b.blocks.double_indir_block) << log2_blksz,
-						0, blksz,
-						(char *) indir1_block);
-			if (status == 0) {
-				printf ("** ext2fs read block (indir 2 1) failed. **\n");
-				return (-1);
-			}
-			indir1_blkno =
-				__le32_to_cpu (inode->b.blocks.double_indir_block) << log2_blksz;
-		}
-
-		if (indir2_block == NULL) {
-			indir2_block = (uint32_t *) malloc (blksz);
-			if (indir2_block == NULL) {
-				printf ("** ext2fs read block (indir 2 2) malloc failed. **\n");
-				return (-1);
-			}
-			indir2_size = blksz;
-			indir2_blkno = -1;
-		}
-		if (blksz != indir2_size) {
-			free (indir2_block);
-			indir2_block = NULL;
-			indir2_size = 0;
-			indir2_blkno = -1;
-			indir2_block = (uint32_t *) malloc (blksz);
-			if (indir2_block == NULL) {
-				printf ("** ext2fs read block (indir 2 2) malloc failed. **\n");
-				return (-1);
-			}
-			indir2_size = blksz;
-		}
-		if ((__le32_to_cpu (indir1_block[rblock / perblock]) <<
-		     log2_blksz) != indir1_blkno) {
-			status = ext2fs_devread (__le32_to_cpu(indir1_block[rblock / perblock]) << log2_blksz,
-						 0, blksz,
-						 (char *) indir2_block);
-			if (status == 0) {
-				printf ("** ext2fs read block (indir 2 2) failed. **\n");
-				return (-1);
-			}
-			indir2_blkno =
-				__le32_to_cpu (indir1_block[rblock / perblock]) << log2_blksz;
-		}
-		blknr = __le32_to_cpu (indir2_block[rblock % perblock]);
+	else if ((rblock -= perblock) < perblock * perblock) {
+		blknr = ext2fs_read_indir (data,
+					   __le32_to_cpu (inode->b.blocks.double_indir_block),
+					   rblock / perblock);
+		blknr = ext2fs_read_indir (data, blknr, rblock % perblock);
 	}
 	/* Tripple indirect.  */
+	else if ((rblock -= perblock * perblock) / perblock / perblock
+		 < perblock) {
+		blknr = ext2fs_read_indir (data,
+					   __le32_to_cpu (inode->b.blocks.tripple_indir_block),
+					   rblock / perblock / perblock);
+		blknr = ext2fs_read_indir (data, blknr,
+					   rblock / perblock % perblock);
+		blknr = ext2fs_read_indir (data, blknr, rblock % perblock);
+	}
 	else {
-		printf ("** ext2fs doesn't support tripple indirect blocks. **\n");
+		printf ("** ext2fs block %d out of range. **\n", fileblock);
 		return (-1);
 	}
 #ifdef DEBUG
@@ -387,6 +383,7 @@ int ext2fs_read_file
 	(ext2fs_node_t node, int pos, unsigned int len, char *buf) {
 	int i;
 	int blockcnt;
+	int fullcnt;
 	int log2blocksize = LOG2_EXT2_BLOCK_SIZE (node->data);
 	int blocksize = 1 << (log2blocksize + DISK_SECTOR_BITS);
 	unsigned int filesize = __le32_to_cpu(node->inode.size);
@@ -396,11 +393,14 @@ int ext2fs_read_file
 		len = filesize;
 	}
 	blockcnt = ((len + pos) + blocksize - 1) / blocksize;
+	/* Blocks below this one are read up to their end.  */
+	fullcnt = (len + pos) / blocksize;
 
 	for (i = pos / blocksize; i < blockcnt; i++) {
 		int blknr;
 		int blockoff = pos % blocksize;
 		int blockend = blocksize;
+		int run = 1;
 
 		int skipfirst = 0;
 
@@ -408,7 +408,6 @@ int ext2fs_read_file
 		if (blknr < 0) {
 			return (-1);
 		}
-		blknr = blknr << log2blocksize;
 
 		/* Last block.  */
 		if (i == blockcnt - 1) {
@@ -426,19 +425,38 @@ int ext2fs_read_file
 			blockend -= skipfirst;
 		}
 
+		/* Whole blocks which follow each other on disk are read
+		   with a single device access straight into buf.  */
+		if (blknr && !skipfirst && blockend == blocksize) {
+			while (i + run < fullcnt &&
+			       ext2fs_read_block (node, i + run) == blknr + run) {
+				run++;
+			}
+			blockend = run * blocksize;
+		}
+
 		/* If the block number is 0 this block is not stored on disk but
 		   is zero filled instead.  */
-		if (blknr) {
+		if (!blknr) {
+			memset (buf, 0, blockend);
+		} else if (skipfirst || blockend < blocksize) {
+			char *blk = ext2fs_cache_get (node->data, blknr);
+
+			if (blk == NULL) {
+				return (-1);
+			}
+			memcpy (buf, blk + skipfirst, blockend);
+		} else {
 			int status;
 
-			status = ext2fs_devread (blknr, skipfirst, blockend, buf);
+			status = ext2fs_devread (blknr << log2blocksize, 0,
+						 blockend, buf);
 			if (status == 0) {
 				return (-1);
 			}
-		} else {
-			memset (buf, 0, blocksize - skipfirst);
 		}
-		buf += blocksize - skipfirst;
+		buf += blockend;
+		i += run - 1;
 	}
 	return (len);
 }
@@ -804,18 +822,7 @@ int ext2fs_close (void
 		free (ext2fs_root);
 		ext2fs_root = NULL;
 	}
-	if (indir1_block != NULL) {
-		free (indir1_block);
-		indir1_block = NULL;
-		indir1_size = 0;
-		indir1_blkno = -1;
-	}
-	if (indir2_block != NULL) {
-		free (indir2_block);
-		indir2_block = NULL;
-		indir2_size = 0;
-		indir2_blkno = -1;
-	}
+	ext2fs_cache_free ();
 	return (0);
 }
 
@@ -831,7 +838,10 @@ int ext2fs_read (char *buf, unsigned len) {
 		return (0);
 	}
 
+	ext2fs_devread_cnt = 0;
 	status = ext2fs_read_file (ext2fs_file, 0, len, buf);
+	debug ("ext2fs_read: %d bytes in %lu device reads\n",
+	       status, ext2fs_devread_cnt);
 	return (status);
 }
 
@@ -844,6 +854,8 @@ int ext2fs_mount (unsigned part_length) {
 	if (!data) {
 		return (0);
 	}
+	/* The device may have changed since the last mount.  */
+	ext2fs_cache_free ();
 	/* Read the superblock.  */
 	status = ext2fs_devread (1 * 2, 0, sizeof (struct ext2_sblock),
 				 (char *) &data->sblock);
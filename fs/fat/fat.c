@@ -2,6 +2,7 @@
  * fat.c
  *
  * R/O (V)FAT 12/16/32 filesystem implementation by Marcus Sundberg
+ * (with optional write support, see CONFIG_FAT_WRITE)
  *
  * 2002-07-28 - rjones@nexus-tech.net - ported to ppcboot v1.1.6
  * 2003-03-10 - kharris@nexus-tech.net - ported to uboot
@@ -25,11 +26,42 @@
  * MA 02111-1307 USA
  */
 
+#ifndef USE_HOSTCC
 #include <common.h>
 #include <config.h>
 #include <fat.h>
 #include <asm/byteorder.h>
 #include <part.h>
+#include <rtc.h>
+#else
+/* tools/fat_write_test builds this file on the host */
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/types.h>
+typedef unsigned char uchar;
+#include <part.h>
+#include <fat.h>
+extern uint32_t crc32 (uint32_t, const unsigned char *, unsigned int);
+
+/* <asm/byteorder.h> describes the target, which need not be the host */
+#undef FAT2CPU16
+#undef FAT2CPU32
+static __u16 fat2cpu16 (__u16 x)
+{
+	__u8 *p = (__u8 *)&x;
+
+	return p[0] | p[1] << 8;
+}
+static __u32 fat2cpu32 (__u32 x)
+{
+	__u8 *p = (__u8 *)&x;
+
+	return p[0] | p[1] << 8 | p[2] << 16 | (__u32)p[3] << 24;
+}
+#define FAT2CPU16(x)	fat2cpu16(x)
+#define FAT2CPU32(x)	fat2cpu32(x)
+#endif /* USE_HOSTCC */
 
 #if defined(CONFIG_CMD_FAT)
 
@@ -52,6 +84,7 @@ static int cur_part = 1;
 #define DOS_PART_TBL_OFFSET	0x1be
 #define DOS_PART_MAGIC_OFFSET	0x1fe
 #define DOS_FS_TYPE_OFFSET	0x36
+#define DOS_FS32_TYPE_OFFSET	0x52
 
 int disk_read (__u32 startblock, __u32 getsize, __u8 * bufptr)
 {
@@ -70,7 +103,13 @@ int
 fat_register_device(block_dev_desc_t *dev_desc, int part_no)
 {
 	unsigned char buffer[SECTOR_SIZE];
+#if (defined(CONFIG_CMD_IDE) || \
+     defined(CONFIG_CMD_SCSI) || \
+     defined(CONFIG_CMD_USB) || \
+     defined(CONFIG_MMC) || \
+     defined(CONFIG_SYSTEMACE) )
 	disk_partition_t info;
+#endif
 
 	if (!dev_desc->block_read)
 		return -1;
@@ -94,7 +133,8 @@ fat_register_device(block_dev_desc_t *dev_desc, int part_no)
 	if (!get_partition_info (dev_desc, part_no, &info)) {
 		part_offset = info.start;
 		cur_part = part_no;
-	} else if (!strncmp((char *)&buffer[DOS_FS_TYPE_OFFSET], "FAT", 3)) {
+	} else if (!strncmp((char *)&buffer[DOS_FS_TYPE_OFFSET], "FAT", 3) ||
+		   !strncmp((char *)&buffer[DOS_FS32_TYPE_OFFSET], "FAT32", 5)) {
 		/* ok, we assume we are on a PBR only */
 		cur_part = 1;
 		part_offset = 0;
@@ -105,11 +145,11 @@ fat_register_device(block_dev_desc_t *dev_desc, int part_no)
 	}
 
 #else
-	if (!strncmp((char *)&buffer[DOS_FS_TYPE_OFFSET],"FAT",3)) {
+	if (!strncmp((char *)&buffer[DOS_FS_TYPE_OFFSET],"FAT",3) ||
+	    !strncmp((char *)&buffer[DOS_FS32_TYPE_OFFSET],"FAT32",5)) {
 		/* ok, we assume we are on a PBR only */
 		cur_part = 1;
 		part_offset = 0;
-		info.start = part_offset;
 	} else {
 		/* FIXME we need to determine the start block of the
 		 * partition where the DOS FS resides. This can be done
@@ -190,12 +230,16 @@ static void get_name (dir_entry *dirent, char *s_name)
 	downcase (s_name);
 }
 
+#ifdef CONFIG_FAT_WRITE
+static int flush_fat_buffer(fsdata *mydata);
+#endif
+
 /*
- * Get the entry at index 'entry' in a FAT (12/16/32) table.
- * On failure 0x00 is returned.
+ * Get the entry at index 'entry' in a FAT (12/16/32) table into
+ * '*value'.  Return 0 on success, -1 otherwise.
  */
-static __u32
-get_fatent(fsdata *mydata, __u32 entry)
+static int
+fetch_fatent(fsdata *mydata, __u32 entry, __u32 *value)
 {
 	__u32 bufnum;
 	__u32 offset;
@@ -217,7 +261,7 @@ get_fatent(fsdata *mydata, __u32 entry)
 
 	default:
 		/* Unsupported FAT size */
-		return ret;
+		return -1;
 	}
 
 	/* Read a new block of FAT entries into the cache. */
@@ -227,13 +271,25 @@ get_fatent(fsdata *mydata, __u32 entry)
 		__u32 fatlength = mydata->fatlength;
 		__u32 startblock = bufnum * FATBUFBLOCKS;
 
-		fatlength *= SECTOR_SIZE;	/* We want it in bytes now */
+#ifdef CONFIG_FAT_WRITE
+		/* write back what set_fatent() changed */
+		if (flush_fat_buffer(mydata) != 0)
+			return -1;
+#endif
+		/* a corrupt chain may point past the end of the FAT */
+		if (startblock >= fatlength) {
+			FAT_DPRINT("FAT entry %u out of range\n", entry);
+			return -1;
+		}
+		if (startblock + getsize > fatlength)
+			getsize = fatlength - startblock;
 		startblock += mydata->fat_sect;	/* Offset from start of disk */
 
-		if (getsize > fatlength) getsize = fatlength;
+		/* the buffer holds nothing valid until the read succeeded */
+		mydata->fatbufnum = -1;
 		if (disk_read(startblock, getsize, bufptr) < 0) {
 			FAT_DPRINT("Error reading FAT blocks\n");
-			return ret;
+			return -1;
 		}
 		mydata->fatbufnum = bufnum;
 	}
@@ -281,6 +337,21 @@ get_fatent(fsdata *mydata, __u32 entry)
 	}
 	FAT_DPRINT("ret: %d, offset: %d\n", ret, offset);
 
+	*value = ret;
+	return 0;
+}
+
+/*
+ * Get the entry at index 'entry' in a FAT (12/16/32) table.
+ * On failure 0x00 is returned.
+ */
+static __u32
+get_fatent(fsdata *mydata, __u32 entry)
+{
+	__u32 ret;
+
+	if (fetch_fatent(mydata, entry, &ret) != 0)
+		return 0x00;
 	return ret;
 }
 
@@ -323,11 +394,52 @@ get_cluster(fsdata *mydata, __u32 clustnum, __u8 *buffer, unsigned long size)
 }
 
 
+/*
+ * Map the cluster chain starting at '*clust' into at most 'max' runs of
+ * consecutive clusters, stopping after 'need' (> 0) clusters.
+ * '*clust' is set to the first cluster not mapped yet, or to 0 when no
+ * more clusters are needed or the chain ends early.
+ * Return the number of extents in 'ext'.
+ */
+static int
+get_extents(fsdata *mydata, __u32 *clust, fat_extent *ext, int max,
+	    __u32 need)
+{
+	__u32 curclust = *clust, newclust;
+	int n = 0;
+
+	ext[0].start = curclust;
+	ext[0].count = 1;
+	*clust = 0;
+	while (--need > 0) {
+		newclust = get_fatent(mydata, curclust);
+		if (CHECK_CLUST(newclust, mydata->fatsize)) {
+			FAT_DPRINT("curclust: 0x%x\n", newclust);
+			FAT_ERROR("Invalid FAT entry\n");
+			break;
+		}
+		if (newclust == curclust + 1) {
+			ext[n].count++;
+		} else {
+			if (++n == max) {
+				*clust = newclust;
+				return n;
+			}
+			ext[n].start = newclust;
+			ext[n].count = 1;
+		}
+		curclust = newclust;
+	}
+	return n + 1;
+}
+
+
 /*
  * Read at most 'maxsize' bytes from the file associated with 'dentptr'
  * into 'buffer'.
  * Return the number of bytes read or -1 on fatal errors.
  */
+#define FAT_EXTENTS	16
 static long
 get_contents(fsdata *mydata, dir_entry *dentptr, __u8 *buffer,
 	     unsigned long maxsize)
@@ -335,8 +447,9 @@ get_contents(fsdata *mydata, dir_entry *dentptr, __u8 *buffer,
 	unsigned long filesize = FAT2CPU32(dentptr->size), gotsize = 0;
 	unsigned int bytesperclust = mydata->clust_size * SECTOR_SIZE;
 	__u32 curclust = START(dentptr);
-	__u32 endclust, newclust;
+	fat_extent ext[FAT_EXTENTS];
 	unsigned long actsize;
+	int i, n;
 
 	FAT_DPRINT("Filesize: %ld bytes\n", filesize);
 
@@ -344,57 +457,30 @@ get_contents(fsdata *mydata, dir_entry *dentptr, __u8 *buffer,
 
 	FAT_DPRINT("Reading: %ld bytes\n", filesize);
 
-	actsize=bytesperclust;
-	endclust=curclust;
-	do {
-		/* search for consecutive clusters */
-		while(actsize < filesize) {
-			newclust = get_fatent(mydata, endclust);
-			if((newclust -1)!=endclust)
-				goto getit;
-			if (CHECK_CLUST(newclust, mydata->fatsize)) {
-				FAT_DPRINT("curclust: 0x%x\n", newclust);
-				FAT_DPRINT("Invalid FAT entry\n");
-				return gotsize;
+	while (filesize > 0 && curclust != 0) {
+		/* map the next part of the cluster chain ... */
+		n = get_extents(mydata, &curclust, ext, FAT_EXTENTS,
+				(filesize + bytesperclust - 1) / bytesperclust);
+
+		/* ... and read each run of clusters in one go */
+		for (i = 0; i < n; i++) {
+			actsize = ext[i].count * bytesperclust;
+			if (actsize > filesize)
+				actsize = filesize;
+			FAT_DPRINT("extent %d: %d clusters at 0x%x\n", i,
+				   ext[i].count, ext[i].start);
+			if (get_cluster(mydata, ext[i].start, buffer,
+					actsize) != 0) {
+				FAT_ERROR("Error reading cluster\n");
+				return -1;
 			}
-			endclust=newclust;
-			actsize+= bytesperclust;
+			gotsize += actsize;
+			filesize -= actsize;
+			buffer += actsize;
 		}
-		/* actsize >= file size */
-		actsize -= bytesperclust;
-		/* get remaining clusters */
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
-			FAT_ERROR("Error reading cluster\n");
-			return -1;
-		}
-		/* get remaining bytes */
-		gotsize += (int)actsize;
-		filesize -= actsize;
-		buffer += actsize;
-		actsize= filesize;
-		if (get_cluster(mydata, endclust, buffer, (int)actsize) != 0) {
-			FAT_ERROR("Error reading cluster\n");
-			return -1;
-		}
-		gotsize+=actsize;
-		return gotsize;
-getit:
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
-			FAT_ERROR("Error reading cluster\n");
-			return -1;
-		}
-		gotsize += (int)actsize;
-		filesize -= actsize;
-		buffer += actsize;
-		curclust = get_fatent(mydata, endclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			FAT_DPRINT("curclust: 0x%x\n", curclust);
-			FAT_ERROR("Invalid FAT entry\n");
-			return gotsize;
-		}
-		actsize=bytesperclust;
-		endclust=curclust;
-	} while (1);
+	}
+
+	return gotsize;
 }
 
 
@@ -663,6 +749,93 @@ static dir_entry *get_dentfromdir (fsdata * mydata, int startsect,
 }
 
 
+/*
+ * Directory entry cache: remembers the entries found by name lookups,
+ * keyed by the start cluster of the directory searched (0 for the root
+ * directory) and the lower case name.  It is kept across commands and
+ * flushed when the device, the partition or the identity of the volume
+ * change: a CRC of the boot sector and, on FAT32, of the free cluster
+ * count and next free cluster of the FSInfo sector, which are checked
+ * on every lookup.
+ */
+static fat_dcache_ent fat_dcache[CFG_FAT_DCACHE_SIZE];
+static unsigned long fat_dcache_tick = 0;
+static block_dev_desc_t *fat_dcache_dev = NULL;
+static unsigned long fat_dcache_part = 0;
+static __u32 fat_dcache_id;
+
+static void
+fat_dcache_check(boot_sector *bs, int fatsize)
+{
+	__u8 block[FS_BLOCK_SIZE];
+	__u32 *info = (__u32 *)block;
+	__u32 id;
+
+	if (disk_read(0, 1, block) != 1) {
+		/* can't tell, so don't trust the cache */
+		memset(fat_dcache, 0, sizeof(fat_dcache));
+		fat_dcache_dev = NULL;
+		return;
+	}
+	id = crc32(0, block, FS_BLOCK_SIZE);
+
+	if (fatsize == 32 && bs->info_sector != 0 &&
+	    bs->info_sector < bs->reserved &&
+	    disk_read(bs->info_sector, 1, block) == 1 &&
+	    FAT2CPU32(info[0]) == 0x41615252 &&
+	    FAT2CPU32(info[121]) == 0x61417272)
+		id = crc32(id, (unsigned char *)&info[122], 8);
+
+	if (fat_dcache_dev == cur_dev && fat_dcache_part == part_offset &&
+	    fat_dcache_id == id)
+		return;
+
+	FAT_DPRINT("flushing dentry cache\n");
+	memset(fat_dcache, 0, sizeof(fat_dcache));
+	fat_dcache_dev = cur_dev;
+	fat_dcache_part = part_offset;
+	fat_dcache_id = id;
+}
+
+static dir_entry *
+fat_dcache_lookup(__u32 parent, const char *name)
+{
+	int i;
+
+	for (i = 0; i < CFG_FAT_DCACHE_SIZE; i++) {
+		fat_dcache_ent *ent = &fat_dcache[i];
+
+		if (ent->lru && ent->parent == parent &&
+		    !strcmp(ent->name, name)) {
+			FAT_DPRINT("dcache hit: %s\n", name);
+			ent->lru = ++fat_dcache_tick;
+			return &ent->dent;
+		}
+	}
+	return NULL;
+}
+
+static void
+fat_dcache_insert(__u32 parent, const char *name, dir_entry *dent)
+{
+	fat_dcache_ent *ent = &fat_dcache[0];
+	int i;
+
+	if (strlen(name) >= FAT_DCACHE_NAMELEN)
+		return;
+
+	/* Replace the least recently used entry */
+	for (i = 1; i < CFG_FAT_DCACHE_SIZE; i++) {
+		if (fat_dcache[i].lru < ent->lru)
+			ent = &fat_dcache[i];
+	}
+	ent->parent = parent;
+	ent->lru = ++fat_dcache_tick;
+	strcpy(ent->name, name);
+	memcpy(&ent->dent, dent, sizeof(dir_entry));
+}
+
+
 /*
  * Read boot sector and volume info from a FAT filesystem
  */
@@ -728,6 +901,8 @@ read_bootsectandvi(boot_sector *bs, volume_info *volinfo, int *fatsize)
 
 
 __u8 do_fat_read_block[MAX_CLUSTSIZE];  /* Block buffer */
+__u8 do_fat_read_fatbuf[FATBUFSIZE]	/* FAT buffer */
+	__attribute__ ((aligned (4)));
 long
 do_fat_read (const char *filename, void *buffer, unsigned long maxsize,
 	     int dols)
@@ -740,7 +915,8 @@ do_fat_read (const char *filename, void *buffer, unsigned long maxsize,
     volume_info volinfo;
     fsdata datablock;
     fsdata *mydata = &datablock;
-    dir_entry *dentptr;
+    dir_entry *dentptr, *cached;
+    dir_entry dent;
     __u16 prevcksum = 0xffff;
     char *subname = "";
     int rootdir_size, cursect;
@@ -753,6 +929,7 @@ do_fat_read (const char *filename, void *buffer, unsigned long maxsize,
 	FAT_DPRINT ("Error: reading boot sector\n");
 	return -1;
     }
+    fat_dcache_check (&bs, mydata->fatsize);
     if (mydata->fatsize == 32) {
 	mydata->fatlength = bs.fat32_length;
     } else {
@@ -772,7 +949,11 @@ do_fat_read (const char *filename, void *buffer, unsigned long maxsize,
 	mydata->data_begin = mydata->rootdir_sect + rootdir_size
 		- (mydata->clust_size * 2);
     }
+    mydata->fatbuf = do_fat_read_fatbuf;
     mydata->fatbufnum = -1;
+#ifdef CONFIG_FAT_WRITE
+    mydata->fatdirty_first = -1;
+#endif
 
     FAT_DPRINT ("FAT%d, fatlength: %d\n", mydata->fatsize,
 		mydata->fatlength);
@@ -803,6 +984,15 @@ do_fat_read (const char *filename, void *buffer, unsigned long maxsize,
 	isdir = 1;
     }
 
+    if (dols != LS_ROOT
+	&& (cached = fat_dcache_lookup (0, fnamecopy)) != NULL) {
+	dentptr = (dir_entry *) do_fat_read_block;
+	*dentptr = *cached;
+	if (isdir && !(dentptr->attr & ATTR_DIR))
+	    return -1;
+	goto rootdir_done;
+    }
+
     while (1) {
 	int i;
 
@@ -915,6 +1105,7 @@ do_fat_read (const char *filename, void *buffer, unsigned long maxsize,
 	    FAT_DPRINT (", start: 0x%x", START (dentptr));
 	    FAT_DPRINT (", size:  0x%x %s\n",
 			FAT2CPU32 (dentptr->size), isdir ? "(DIR)" : "");
+	    fat_dcache_insert (0, fnamecopy, dentptr);
 
 	    goto rootdir_done;  /* We got a match */
 	}
@@ -926,7 +1117,6 @@ do_fat_read (const char *filename, void *buffer, unsigned long maxsize,
     while (isdir) {
 	int startsect = mydata->data_begin
 		+ START (dentptr) * mydata->clust_size;
-	dir_entry dent;
 	char *nextname = NULL;
 
 	dent = *dentptr;
@@ -949,11 +1139,21 @@ do_fat_read (const char *filename, void *buffer, unsigned long maxsize,
 	    }
 	}
 
-	if (get_dentfromdir (mydata, startsect, subname, dentptr,
-			     isdir ? 0 : dols) == NULL) {
-	    if (dols && !isdir)
+	if (!isdir && dols) {
+	    /* list the directory */
+	    if (get_dentfromdir (mydata, startsect, subname, dentptr,
+				 dols) == NULL)
 		return 0;
-	    return -1;
+	} else if ((cached = fat_dcache_lookup (START (dentptr), subname))
+		   != NULL) {
+	    *dentptr = *cached;
+	} else {
+	    __u32 parent = START (dentptr);
+
+	    if (get_dentfromdir (mydata, startsect, subname, dentptr, 0)
+		== NULL)
+		return -1;
+	    fat_dcache_insert (parent, subname, dentptr);
 	}
 
 	if (idx >= 0) {
@@ -1025,4 +1225,646 @@ file_fat_read(const char *filename, void *buffer, unsigned long maxsize)
 	return do_fat_read(filename, buffer, maxsize, LS_NO);
 }
 
+#ifdef CONFIG_FAT_WRITE
+/*
+ * Write support
+ *
+ * A file is always written as a whole.  Its clusters are allocated in
+ * runs of consecutive free clusters and the data of each run goes to
+ * disk with a single disk_write().  FAT changes are made in the FAT
+ * buffer of get_fatent() and written back, to all FAT copies, only when
+ * get_fatent() moves on to another part of the FAT or the file is
+ * complete, so each FAT sector is written about once per file.  The
+ * clusters of a file being replaced are released only after the new
+ * data is on disk.
+ *
+ * Only 8.3 names are supported, and the directories on the path must
+ * exist already.
+ */
+static struct {
+	__u32	root_cluster;	/* FAT32 root directory */
+	__u32	rootdir_size;	/* FAT12/16 root directory, in sectors */
+	__u32	clusters;	/* Highest cluster number + 1 */
+	__u16	info_sector;	/* FAT32 FSInfo sector */
+} fatwr;
+
+/* Directory walk, see dir_walk_next() */
+typedef struct {
+	__u32	clust;		/* Current cluster, 0 for FAT12/16 root dir */
+	__u32	idx;		/* Next sector in cluster or root directory */
+	__u32	sect;		/* Current sector */
+} dir_walk;
+
+#define FAT_EOC(fatsize)	((fatsize) == 32 ? 0x0fffffff : \
+				 (fatsize) == 16 ? 0xffff : 0xfff)
+/* End of chain, free, bad or otherwise not a valid next cluster */
+#define FAT_CHAIN_END(x)	((x) < 2 || (x) >= fatwr.clusters)
+
+static int
+disk_write (__u32 startblock, __u32 putsize, __u8 * bufptr)
+{
+	startblock += part_offset;
+	if (cur_dev == NULL || cur_dev->block_write == NULL)
+		return -1;
+	return cur_dev->block_write (cur_dev->dev, startblock, putsize,
+				     bufptr);
+}
+
+
+/*
+ * Write the modified sectors of the FAT buffer to every FAT copy.
+ * Return 0 on success, -1 otherwise.
+ */
+static int
+flush_fat_buffer(fsdata *mydata)
+{
+	__u32 startblock, getsize;
+	int i;
+
+	if (mydata->fatdirty_first < 0)
+		return 0;
+
+	startblock = mydata->fatbufnum * FATBUFBLOCKS
+		     + mydata->fatdirty_first;
+	getsize = mydata->fatdirty_last - mydata->fatdirty_first + 1;
+	for (i = 0; i < mydata->fats; i++) {
+		if (disk_write(mydata->fat_sect + i * mydata->fatlength
+			       + startblock, getsize, mydata->fatbuf
+			       + mydata->fatdirty_first * SECTOR_SIZE)
+		    != getsize) {
+			FAT_ERROR("Error writing FAT blocks\n");
+			return -1;
+		}
+	}
+	mydata->fatdirty_first = -1;
+	return 0;
+}
+
+
+/*
+ * Set the entry at index 'entry' in a FAT (12/16/32) table.
+ * Return 0 on success, -1 otherwise.
+ */
+static int
+set_fatent(fsdata *mydata, __u32 entry, __u32 value)
+{
+	__u32 bufnum, offset, entries;
+	int first, last;
+
+	switch (mydata->fatsize) {
+	case 32:
+		entries = FAT32BUFSIZE;
+		break;
+	case 16:
+		entries = FAT16BUFSIZE;
+		break;
+	default:
+		entries = FAT12BUFSIZE;
+		break;
+	}
+	bufnum = entry / entries;
+	offset = entry - bufnum * entries;
+
+	/* Let fetch_fatent() read the right part of the FAT */
+	if (bufnum != mydata->fatbufnum) {
+		__u32 old;
+
+		if (fetch_fatent(mydata, entry, &old) != 0 ||
+		    bufnum != mydata->fatbufnum)
+			return -1;
+	}
+
+	switch (mydata->fatsize) {
+	case 32: {
+		__u32 *p = (__u32 *)mydata->fatbuf + offset;
+
+		/* the top 4 bits are reserved */
+		value = (FAT2CPU32(*p) & 0xf0000000) | (value & 0x0fffffff);
+		*p = FAT2CPU32(value);
+		first = last = offset * 4 / SECTOR_SIZE;
+		break;
+	}
+	case 16:
+		((__u16 *)mydata->fatbuf)[offset] = FAT2CPU16(value);
+		first = last = offset * 2 / SECTOR_SIZE;
+		break;
+	default: {
+		__u8 *p = mydata->fatbuf + offset * 3 / 2;
+
+		if (offset & 1) {
+			p[0] = (p[0] & 0x0f) | (value << 4);
+			p[1] = value >> 4;
+		} else {
+			p[0] = value;
+			p[1] = (p[1] & 0xf0) | ((value >> 8) & 0x0f);
+		}
+		/* may straddle two sectors */
+		first = (offset * 3 / 2) / SECTOR_SIZE;
+		last = (offset * 3 / 2 + 1) / SECTOR_SIZE;
+		break;
+	}
+	}
+
+	if (mydata->fatdirty_first < 0) {
+		mydata->fatdirty_first = first;
+		mydata->fatdirty_last = last;
+	} else {
+		if (first < mydata->fatdirty_first)
+			mydata->fatdirty_first = first;
+		if (last > mydata->fatdirty_last)
+			mydata->fatdirty_last = last;
+	}
+	return 0;
+}
+
+
+/*
+ * Find the first run of 'count' free clusters, or failing that the
+ * longest run there is.  Set '*start' to its first cluster, 0 if the
+ * disk is full, and '*len' to its length.  Return 0 on success, -1 if
+ * the FAT can not be read.
+ */
+static int
+find_free_run(fsdata *mydata, __u32 count, __u32 *start, __u32 *len)
+{
+	__u32 clust, n, ent;
+
+	*start = 0;
+	*len = 0;
+	for (clust = 2; clust < fatwr.clusters; clust += n + 1) {
+		for (n = 0; n < count && clust + n < fatwr.clusters; n++) {
+			if (fetch_fatent(mydata, clust + n, &ent) != 0)
+				return -1;
+			if (ent != 0)
+				break;
+		}
+		if (n > *len) {
+			*start = clust;
+			*len = n;
+			if (n == count)
+				break;
+		}
+	}
+	return 0;
+}
+
+
+/*
+ * Release the cluster chain starting at 'clust'.
+ * Return 0 on success, -1 otherwise.
+ */
+static int
+free_chain(fsdata *mydata, __u32 clust)
+{
+	__u32 next, n;
+
+	for (n = 0; !FAT_CHAIN_END(clust) && n < fatwr.clusters; n++) {
+		if (fetch_fatent(mydata, clust, &next) != 0 ||
+		    set_fatent(mydata, clust, 0) != 0)
+			return -1;
+		clust = next;
+	}
+	return 0;
+}
+
+
+/*
+ * Write 'size' bytes to the clusters starting at 'clustnum'.
+ * Return 0 on success, -1 otherwise.
+ */
+static int
+put_cluster(fsdata *mydata, __u32 clustnum, __u8 *buffer, unsigned long size)
+{
+	__u32 startsect = mydata->data_begin + clustnum * mydata->clust_size;
+	__u32 nsect = size / SECTOR_SIZE;
+
+	FAT_DPRINT("pc - clustnum: %d, startsect: %d\n", clustnum, startsect);
+	if (nsect && disk_write(startsect, nsect, buffer) != nsect) {
+		FAT_DPRINT("Error writing data\n");
+		return -1;
+	}
+	if (size % SECTOR_SIZE) {
+		__u8 tmpbuf[FS_BLOCK_SIZE];
+
+		memset(tmpbuf, 0, FS_BLOCK_SIZE);
+		memcpy(tmpbuf, buffer + nsect * SECTOR_SIZE, size % SECTOR_SIZE);
+		if (disk_write(startsect + nsect, 1, tmpbuf) != 1) {
+			FAT_DPRINT("Error writing data\n");
+			return -1;
+		}
+	}
+	return 0;
+}
+
+
+static void
+dir_walk_start(fsdata *mydata, dir_walk *w, __u32 dirclust)
+{
+	if (dirclust == 0 && mydata->fatsize == 32)
+		dirclust = fatwr.root_cluster;
+	w->clust = dirclust;
+	w->idx = 0;
+}
+
+/*
+ * Advance to the next sector of a directory.  Return 1 and set w->sect,
+ * or return 0 at the end of the directory, leaving w->clust at the last
+ * cluster, or -1 if the FAT can not be read.
+ */
+static int
+dir_walk_next(fsdata *mydata, dir_walk *w)
+{
+	if (w->clust == 0) {
+		if (w->idx >= fatwr.rootdir_size)
+			return 0;
+		w->sect = mydata->rootdir_sect + w->idx++;
+		return 1;
+	}
+	if (w->idx == mydata->clust_size) {
+		__u32 next;
+
+		if (fetch_fatent(mydata, w->clust, &next) != 0)
+			return -1;
+		if (FAT_CHAIN_END(next))
+			return 0;
+		w->clust = next;
+		w->idx = 0;
+	}
+	w->sect = mydata->data_begin + w->clust * mydata->clust_size
+		  + w->idx++;
+	return 1;
+}
+
+
+/*
+ * Look for the short name 'name' in the directory starting at cluster
+ * 'dirclust' (0 for the root directory).  Return 1 if found, 0 if not,
+ * -1 on errors.  '*sect' and '*idx' locate the entry found or else the
+ * first free entry; '*sect' is 0 if the directory is full.
+ */
+static int
+find_dirent(fsdata *mydata, dir_walk *w, __u32 dirclust, const __u8 *name,
+	    dir_entry *retdent, __u32 *sect, int *idx)
+{
+	__u8 block[FS_BLOCK_SIZE];
+	dir_entry *dentptr;
+	int i;
+
+	*sect = 0;
+	dir_walk_start(mydata, w, dirclust);
+	while ((i = dir_walk_next(mydata, w)) != 0) {
+		if (i < 0 || disk_read(w->sect, 1, block) != 1) {
+			FAT_DPRINT("Error: reading directory block\n");
+			return -1;
+		}
+		dentptr = (dir_entry *)block;
+		for (i = 0; i < DIRENTSPERBLOCK; i++, dentptr++) {
+			if (dentptr->name[0] == 0 ||
+			    dentptr->name[0] == DELETED_FLAG) {
+				if (*sect == 0) {
+					*sect = w->sect;
+					*idx = i;
+				}
+				if (dentptr->name[0] == 0)
+					return 0;
+				continue;
+			}
+			if (!(dentptr->attr & ATTR_VOLUME) &&
+			    !memcmp(dentptr->name, name, 11)) {
+				memcpy(retdent, dentptr, sizeof(dir_entry));
+				*sect = w->sect;
+				*idx = i;
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
+
+
+/*
+ * Append a cleared cluster to the directory 'w' ended in.
+ * Return its first sector, or 0 on failure.
+ */
+static __u32
+extend_dir(fsdata *mydata, dir_walk *w)
+{
+	__u32 clust, len, startsect;
+
+	if (w->clust == 0) {
+		FAT_ERROR("Root directory full\n");
+		return 0;
+	}
+	if (find_free_run(mydata, 1, &clust, &len) != 0) {
+		FAT_ERROR("Error reading FAT\n");
+		return 0;
+	}
+	if (clust == 0) {
+		FAT_ERROR("Disk full\n");
+		return 0;
+	}
+	startsect = mydata->data_begin + clust * mydata->clust_size;
+	memset(do_fat_read_block, 0, mydata->clust_size * SECTOR_SIZE);
+	if (disk_write(startsect, mydata->clust_size, do_fat_read_block)
+	    != mydata->clust_size ||
+	    set_fatent(mydata, clust, FAT_EOC(mydata->fatsize)) != 0 ||
+	    set_fatent(mydata, w->clust, clust) != 0) {
+		FAT_ERROR("Error extending directory\n");
+		return 0;
+	}
+	return startsect;
+}
+
+
+/*
+ * Convert 'name' to the blank padded upper case form used in directory
+ * entries.  Return 0 on success, -1 if it isn't a valid 8.3 name.
+ */
+static int
+fat_name83(const char *name, __u8 *raw)
+{
+	__u8 *p = raw, *end = raw + 8;
+
+	memset(raw, ' ', 11);
+	if (*name == '.')
+		return -1;
+	for (; *name != '\0'; name++) {
+		char c = *name;
+
+		if (c == '.') {
+			if (end == raw + 11)
+				return -1;
+			p = raw + 8;
+			end = raw + 11;
+			continue;
+		}
+		if (p == end || c <= ' ' || strchr("\"*+,/:;<=>?[\\]|", c))
+			return -1;
+		if (c >= 'a' && c <= 'z')
+			c -= 'a' - 'A';
+		*p++ = c;
+	}
+	if (raw[0] == ' ')
+		return -1;
+	if (raw[0] == (__u8)DELETED_FLAG)
+		raw[0] = aRING;
+	return 0;
+}
+
+
+static int
+fat_write_mount(fsdata *mydata)
+{
+	boot_sector bs;
+	volume_info volinfo;
+	__u32 total_sect, maxclust;
+	int rootdir_size = 0;
+
+	if (read_bootsectandvi(&bs, &volinfo, &mydata->fatsize)) {
+		FAT_DPRINT("Error: reading boot sector\n");
+		return -1;
+	}
+	if (bs.sector_size[0] + (bs.sector_size[1] << 8) != SECTOR_SIZE) {
+		FAT_ERROR("Unsupported sector size\n");
+		return -1;
+	}
+	if (mydata->fatsize == 32) {
+		mydata->fatlength = bs.fat32_length;
+		fatwr.root_cluster = bs.root_cluster;
+		fatwr.info_sector = bs.info_sector;
+	} else {
+		mydata->fatlength = bs.fat_length;
+		rootdir_size = ((bs.dir_entries[1] * (int) 256 + bs.dir_entries[0])
+				* sizeof (dir_entry)) / SECTOR_SIZE;
+	}
+	mydata->fat_sect = bs.reserved;
+	mydata->rootdir_sect = mydata->fat_sect + mydata->fatlength * bs.fats;
+	mydata->clust_size = bs.cluster_size;
+	mydata->data_begin = mydata->rootdir_sect + rootdir_size
+		- (mydata->clust_size * 2);
+	mydata->fatbuf = do_fat_read_fatbuf;
+	mydata->fatbufnum = -1;
+	mydata->fats = bs.fats;
+	mydata->fatdirty_first = -1;
+	mydata->fatdirty_last = -1;
+
+	total_sect = bs.sectors[0] + (bs.sectors[1] << 8);
+	if (total_sect == 0)
+		total_sect = bs.total_sect;
+	if (mydata->clust_size == 0 || mydata->fats == 0 ||
+	    total_sect <= mydata->rootdir_sect + rootdir_size) {
+		FAT_ERROR("Bad volume geometry\n");
+		return -1;
+	}
+	fatwr.rootdir_size = rootdir_size;
+	fatwr.clusters = (total_sect - mydata->rootdir_sect - rootdir_size)
+			 / mydata->clust_size + 2;
+	/* limited by the size of the FAT and the reserved values */
+	if (mydata->fatsize == 12)
+		maxclust = mydata->fatlength * (SECTOR_SIZE * 2) / 3;
+	else
+		maxclust = mydata->fatlength
+			   * (SECTOR_SIZE * 8 / mydata->fatsize);
+	if (maxclust > FAT_EOC(mydata->fatsize) - 8)
+		maxclust = FAT_EOC(mydata->fatsize) - 8;
+	if (fatwr.clusters > maxclust)
+		fatwr.clusters = maxclust;
+
+	/* The directory entry cache is stale after writing */
+	fat_dcache_dev = NULL;
+	return 0;
+}
+
+
+/*
+ * Mark the free cluster count of the FAT32 FSInfo sector unknown.
+ */
+static void
+fat_update_fsinfo(fsdata *mydata)
+{
+	__u8 block[FS_BLOCK_SIZE];
+	__u32 *info = (__u32 *)block;
+
+	if (mydata->fatsize != 32 || fatwr.info_sector == 0 ||
+	    fatwr.info_sector >= mydata->fat_sect)
+		return;
+	if (disk_read(fatwr.info_sector, 1, block) != 1 ||
+	    FAT2CPU32(info[0]) != 0x41615252 ||
+	    FAT2CPU32(info[121]) != 0x61417272)
+		return;
+	info[122] = 0xffffffff;		/* free clusters */
+	info[123] = 0xffffffff;		/* next free cluster */
+	disk_write(fatwr.info_sector, 1, block);
+}
+
+
+static long
+do_fat_write (const char *filename, void *buffer, unsigned long size)
+{
+    char path[256];
+    fsdata datablock;
+    fsdata *mydata = &datablock;
+    dir_entry dent, *dentptr;
+    dir_walk walk;
+    __u8 name[11];
+    __u8 block[FS_BLOCK_SIZE];
+    char *subname, *nextname;
+    __u32 dirclust = 0, oldclust = 0, clust, prev = 0, start = 0;
+    __u32 needed, len, sect;
+    unsigned int bytesperclust;
+    unsigned long left = size, actsize;
+    __u8 *data = buffer;
+    int idx, found;
+
+    if (cur_dev == NULL || cur_dev->block_write == NULL) {
+	FAT_ERROR ("Device is not writable\n");
+	return -1;
+    }
+    if (strlen (filename) >= sizeof (path)) {
+	FAT_ERROR ("File name too long\n");
+	return -1;
+    }
+    if (fat_write_mount (mydata))
+	return -1;
+
+    /* Walk down the directories on the path */
+    subname = path;
+    strcpy (path, filename);
+    while (ISDIRDELIM (*subname))
+	subname++;
+    while ((idx = dirdelim (subname)) >= 0) {
+	subname[idx] = '\0';
+	nextname = subname + idx + 1;
+	while (ISDIRDELIM (*nextname))
+	    nextname++;
+	if (fat_name83 (subname, name) ||
+	    find_dirent (mydata, &walk, dirclust, name, &dent, &sect,
+			 &idx) != 1 ||
+	    !(dent.attr & ATTR_DIR)) {
+	    printf ("** Directory %s not found **\n", subname);
+	    return -1;
+	}
+	dirclust = START (&dent);
+	subname = nextname;
+    }
+    if (fat_name83 (subname, name)) {
+	printf ("** %s is not a valid 8.3 file name **\n", subname);
+	return -1;
+    }
+
+    found = find_dirent (mydata, &walk, dirclust, name, &dent, &sect, &idx);
+    if (found < 0)
+	return -1;
+    if (found) {
+	if (dent.attr & (ATTR_DIR | ATTR_RO | ATTR_SYS)) {
+	    printf ("** %s is read-only or a directory **\n", subname);
+	    return -1;
+	}
+	oldclust = START (&dent);
+    }
+
+    /* Allocate runs of clusters and write the data to them */
+    bytesperclust = mydata->clust_size * SECTOR_SIZE;
+    needed = (size + bytesperclust - 1) / bytesperclust;
+    while (needed > 0) {
+	if (find_free_run (mydata, needed, &clust, &len) != 0) {
+	    FAT_ERROR ("Error reading FAT\n");
+	    goto fail;
+	}
+	if (clust == 0) {
+	    FAT_ERROR ("Disk full\n");
+	    goto fail;
+	}
+	if (prev == 0)
+	    start = clust;
+	else if (set_fatent (mydata, prev, clust) != 0)
+	    goto fail;
+	for (prev = clust; prev < clust + len - 1; prev++) {
+	    if (set_fatent (mydata, prev, prev + 1) != 0)
+		goto fail;
+	}
+	if (set_fatent (mydata, prev, FAT_EOC (mydata->fatsize)) != 0)
+	    goto fail;
+
+	actsize = len * bytesperclust;
+	if (actsize > left)
+	    actsize = left;
+	FAT_DPRINT ("run of %d clusters at 0x%x\n", len, clust);
+	if (put_cluster (mydata, clust, data, actsize) != 0) {
+	    FAT_ERROR ("Error writing cluster\n");
+	    goto fail;
+	}
+	data += actsize;
+	left -= actsize;
+	needed -= len;
+    }
+
+    /* The old data is no longer needed */
+    if (found && free_chain (mydata, oldclust) != 0)
+	goto fail;
+
+    if (sect == 0) {
+	/* no free entry, the directory needs another cluster */
+	if ((sect = extend_dir (mydata, &walk)) == 0)
+	    goto fail;
+	idx = 0;
+    }
+    if (flush_fat_buffer (mydata) != 0)
+	return -1;
+
+    /* Finally update the directory entry */
+    if (disk_read (sect, 1, block) != 1) {
+	FAT_DPRINT ("Error: reading directory block\n");
+	return -1;
+    }
+    dentptr = (dir_entry *) block + idx;
+    if (!found) {
+	memset (dentptr, 0, sizeof (dir_entry));
+	memcpy (dentptr->name, name, 11);
+	dentptr->attr = ATTR_ARCH;
+    }
+    dentptr->start = FAT2CPU16 (start & 0xffff);
+    dentptr->starthi = FAT2CPU16 (mydata->fatsize == 32 ? start >> 16 : 0);
+    dentptr->size = FAT2CPU32 (size);
+    {
+#if defined(CONFIG_CMD_DATE)
+	struct rtc_time tm;
+
+	rtc_get (&tm);
+	if (tm.tm_year >= 1980) {
+	    dentptr->date = FAT2CPU16 (((tm.tm_year - 1980) << 9)
+				       | (tm.tm_mon << 5) | tm.tm_mday);
+	    dentptr->time = FAT2CPU16 ((tm.tm_hour << 11)
+				       | (tm.tm_min << 5) | (tm.tm_sec / 2));
+	}
+#endif
+	if (dentptr->date == 0)
+	    dentptr->date = FAT2CPU16 ((1 << 5) | 1);	/* 1980-01-01 */
+    }
+    if (disk_write (sect, 1, block) != 1) {
+	FAT_DPRINT ("Error: writing directory block\n");
+	return -1;
+    }
+    fat_update_fsinfo (mydata);
+
+    return size;
+
+fail:
+    /* Give back what was allocated so far, leaving any old file intact */
+    if (start != 0) {
+	free_chain (mydata, start);
+	flush_fat_buffer (mydata);
+    }
+    return -1;
+}
+
+
+long
+file_fat_write(const char *filename, void *buffer, unsigned long size)
+{
+	printf("writing %s\n", filename);
+	return do_fat_write(filename, buffer, size);
+}
+#endif /* CONFIG_FAT_WRITE */
+
 #endif
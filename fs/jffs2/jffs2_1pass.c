@@ -175,56 +175,142 @@ int read_jffs2_nand(size_t start, size_t len,
 #define NAND_CACHE_PAGES 16
 #endif
 #define NAND_CACHE_SIZE (NAND_CACHE_PAGES*NAND_PAGE_SIZE)
+#if NAND_CACHE_PAGES & (NAND_CACHE_PAGES - 1)
+#error "NAND_CACHE_PAGES must be a power of two"
+#endif
+
+#ifndef NAND_CACHE_SLOTS
+#define NAND_CACHE_SLOTS 8
+#endif
+#define NAND_READ_AHEAD (NAND_CACHE_SLOTS / 2)
 
+/*
+ * The cache holds NAND_CACHE_SLOTS windows of NAND_CACHE_SIZE bytes, each
+ * aligned to its size and so to the NAND page, in one buffer. Slots are
+ * refilled round robin. A miss on the window right after the last one
+ * read fetches several windows with a single nand_read() into consecutive
+ * slots, so a scan reads whole pages in large chunks. The read ahead
+ * doubles, up to NAND_READ_AHEAD windows, as long as all windows read
+ * ahead get used, and shrinks again when some are skipped.
+ */
 static u8* nand_cache = NULL;
-static u32 nand_cache_off = (u32)-1;
+static u32 nand_cache_off[NAND_CACHE_SLOTS];
+static u8 nand_cache_used[NAND_CACHE_SLOTS];
+static int nand_cache_dev = -1;
+static int nand_cache_next;			/* slot to refill next */
+static int nand_cache_last;			/* first slot of the last read */
+static int nand_cache_ra = 1;			/* windows of the last read */
+static u32 nand_cache_seq = (u32)-1;		/* window after the last read */
+static u32 nand_cache_hits, nand_cache_misses, nand_cache_reads;
+
+/* read count windows starting at off into the slots starting at slot */
+static int nand_cache_fill(int slot, u32 off, int count)
+{
+	struct mtdids *id = current_part->dev->id;
+	u_char *buf = nand_cache + slot * NAND_CACHE_SIZE;
+	size_t retlen;
+	int i;
+
+	for (i = 0; i < count; i++)
+		nand_cache_off[slot + i] = (u32)-1;
+	nand_cache_reads++;
+
+#if defined(CFG_NAND_LEGACY)
+	if (read_jffs2_nand(off, count * NAND_CACHE_SIZE,
+				&retlen, buf, id->num) < 0 ||
+			retlen != count * NAND_CACHE_SIZE)
+		return -1;
+#else
+	retlen = count * NAND_CACHE_SIZE;
+	if (nand_read(&nand_info[id->num], off, &retlen, buf) != 0 ||
+			retlen != count * NAND_CACHE_SIZE)
+		return -1;
+#endif
+
+	for (i = 0; i < count; i++) {
+		nand_cache_off[slot + i] = off + i * NAND_CACHE_SIZE;
+		nand_cache_used[slot + i] = 0;
+	}
+	return 0;
+}
 
 static int read_nand_cached(u32 off, u32 size, u_char *buf)
 {
 	struct mtdids *id = current_part->dev->id;
 	u32 bytes_read = 0;
-	size_t retlen;
+	u32 win, end;
 	int cpy_bytes;
+	int slot, count;
+
+	if (!nand_cache) {
+		/* This memory never gets freed but 'cause
+		   it's a bootloader, nobody cares */
+		nand_cache = malloc(NAND_CACHE_SLOTS * NAND_CACHE_SIZE);
+		if (!nand_cache) {
+			printf("read_nand_cached: can't alloc cache size %d bytes\n",
+			       NAND_CACHE_SLOTS * NAND_CACHE_SIZE);
+			return -1;
+		}
+	}
+	if (nand_cache_dev != id->num) {
+		for (slot = 0; slot < NAND_CACHE_SLOTS; slot++)
+			nand_cache_off[slot] = (u32)-1;
+		nand_cache_dev = id->num;
+		nand_cache_seq = (u32)-1;
+	}
 
 	while (bytes_read < size) {
-		if ((off + bytes_read < nand_cache_off) ||
-		    (off + bytes_read >= nand_cache_off+NAND_CACHE_SIZE)) {
-			nand_cache_off = (off + bytes_read) & NAND_PAGE_MASK;
-			if (!nand_cache) {
-				/* This memory never gets freed but 'cause
-				   it's a bootloader, nobody cares */
-				nand_cache = malloc(NAND_CACHE_SIZE);
-				if (!nand_cache) {
-					printf("read_nand_cached: can't alloc cache size %d bytes\n",
-					       NAND_CACHE_SIZE);
-					return -1;
-				}
-			}
+		win = (off + bytes_read) & ~(NAND_CACHE_SIZE - 1);
+		for (slot = 0; slot < NAND_CACHE_SLOTS; slot++)
+			if (nand_cache_off[slot] == win)
+				break;
 
-#if defined(CFG_NAND_LEGACY)
-			if (read_jffs2_nand(nand_cache_off, NAND_CACHE_SIZE,
-						&retlen, nand_cache, id->num) < 0 ||
-					retlen != NAND_CACHE_SIZE) {
-				printf("read_nand_cached: error reading nand off %#x size %d bytes\n",
-						nand_cache_off, NAND_CACHE_SIZE);
-				return -1;
+		if (slot < NAND_CACHE_SLOTS) {
+			nand_cache_hits++;
+		} else {
+			nand_cache_misses++;
+			count = 1;
+			if (win == nand_cache_seq) {
+				/* sequential access, read ahead */
+				for (slot = 0; slot < nand_cache_ra; slot++)
+					if (!nand_cache_used[nand_cache_last + slot])
+						break;
+				if (slot < nand_cache_ra)
+					count = (nand_cache_ra + 1) / 2;
+				else
+					count = nand_cache_ra * 2;
+				if (count > NAND_READ_AHEAD)
+					count = NAND_READ_AHEAD;
+				end = current_part->offset + current_part->size;
+				while (count > 1 &&
+				       win + count * NAND_CACHE_SIZE > end)
+					count--;
 			}
-#else
-			retlen = NAND_CACHE_SIZE;
-			if (nand_read(&nand_info[id->num], nand_cache_off,
-						&retlen, nand_cache) != 0 ||
-					retlen != NAND_CACHE_SIZE) {
-				printf("read_nand_cached: error reading nand off %#x size %d bytes\n",
-						nand_cache_off, NAND_CACHE_SIZE);
-				return -1;
+			if (nand_cache_next + count > NAND_CACHE_SLOTS)
+				nand_cache_next = 0;
+			slot = nand_cache_next;
+
+			/* a failing read ahead must not fail this read */
+			if (nand_cache_fill(slot, win, count) < 0) {
+				count = 1;
+				if (nand_cache_fill(slot, win, count) < 0) {
+					printf("read_nand_cached: error reading nand off %#x size %d bytes\n",
+					       win, NAND_CACHE_SIZE);
+					return -1;
+				}
 			}
-#endif
+			nand_cache_next = (slot + count) % NAND_CACHE_SLOTS;
+			nand_cache_seq = win + count * NAND_CACHE_SIZE;
+			nand_cache_last = slot;
+			nand_cache_ra = count;
 		}
-		cpy_bytes = nand_cache_off + NAND_CACHE_SIZE - (off + bytes_read);
+		nand_cache_used[slot] = 1;
+
+		cpy_bytes = win + NAND_CACHE_SIZE - (off + bytes_read);
 		if (cpy_bytes > size - bytes_read)
 			cpy_bytes = size - bytes_read;
 		memcpy(buf + bytes_read,
-		       nand_cache + off + bytes_read - nand_cache_off,
+		       nand_cache + slot * NAND_CACHE_SIZE + off + bytes_read - win,
 		       cpy_bytes);
 		bytes_read += cpy_bytes;
 	}
@@ -564,6 +650,11 @@ jffs2_free_cache(struct part_info *part)
 		pL = (struct b_lists *)part->jffs2_priv;
 		free_nodes(&pL->frag);
 		free_nodes(&pL->dir);
+		free(pL->frags);
+		free(pL->frag_hash);
+		free(pL->dirents);
+		free(pL->name_hash);
+		free(pL->ino_hash);
 		free(pL);
 	}
 }
@@ -587,11 +678,117 @@ jffs_init_1pass_list(struct part_info *part)
 	return 0;
 }
 
+static u32
+jffs2_hash_mask(u32 count)
+{
+	u32 size = 16;
+
+	while (size < count)
+		size <<= 1;
+	return size - 1;
+}
+
+static u32
+jffs2_name_hash(u32 pino, const char *name, int len)
+{
+	u32 hash = pino;
+
+	while (len--)
+		hash = hash * 31 + (u8)*name++;
+	return hash;
+}
+
+/*
+ * Build the hash index over the complete lists: frags by ino, dirents by
+ * parent ino and name and by ino. Each bucket keeps the list order, so
+ * lookups see the nodes in the same order as a walk of the whole list.
+ */
+static u32
+jffs2_1pass_build_hash(struct b_lists *pL)
+{
+	struct jffs2_raw_inode ojNode, *jNode;
+	struct jffs2_raw_dirent *jDir;
+	struct b_frag_ent *f;
+	struct b_dirent_ent *d;
+	struct b_node *b;
+	u32 i, n;
+
+	pL->frag_mask = jffs2_hash_mask(pL->frag.listCount);
+	pL->dir_mask = jffs2_hash_mask(pL->dir.listCount);
+	pL->frags = malloc(pL->frag.listCount * sizeof(*f));
+	pL->frag_hash = malloc((pL->frag_mask + 1) * sizeof(f));
+	pL->dirents = malloc(pL->dir.listCount * sizeof(*d));
+	pL->name_hash = malloc((pL->dir_mask + 1) * sizeof(d));
+	pL->ino_hash = malloc((pL->dir_mask + 1) * sizeof(d));
+	if (!pL->frags || !pL->frag_hash || !pL->dirents ||
+	    !pL->name_hash || !pL->ino_hash) {
+		printf("jffs2_1pass_build_hash: out of memory\n");
+		return 0;
+	}
+	memset(pL->frag_hash, 0, (pL->frag_mask + 1) * sizeof(f));
+	memset(pL->name_hash, 0, (pL->dir_mask + 1) * sizeof(d));
+	memset(pL->ino_hash, 0, (pL->dir_mask + 1) * sizeof(d));
+
+	for (b = pL->frag.listHead, n = 0; b; b = b->next, n++) {
+		jNode = (struct jffs2_raw_inode *) get_fl_mem(b->offset,
+			sizeof(ojNode), &ojNode);
+		pL->frags[n].offset = b->offset;
+		pL->frags[n].ino = jNode->ino;
+	}
+	/* insert back to front, so that the buckets end up in list order */
+	for (i = n; i-- > 0; ) {
+		f = &pL->frags[i];
+		f->next = pL->frag_hash[f->ino & pL->frag_mask];
+		pL->frag_hash[f->ino & pL->frag_mask] = f;
+	}
+
+	for (b = pL->dir.listHead, n = 0; b; b = b->next, n++) {
+		jDir = (struct jffs2_raw_dirent *) get_node_mem(b->offset);
+		if (jDir == NULL)
+			return 0;
+		pL->dirents[n].offset = b->offset;
+		pL->dirents[n].pino = jDir->pino;
+		pL->dirents[n].ino = jDir->ino;
+		pL->dirents[n].name_hash = jffs2_name_hash(jDir->pino,
+				(char *)jDir->name, jDir->nsize);
+		put_fl_mem(jDir);
+	}
+	for (i = n; i-- > 0; ) {
+		d = &pL->dirents[i];
+		d->name_next = pL->name_hash[d->name_hash & pL->dir_mask];
+		pL->name_hash[d->name_hash & pL->dir_mask] = d;
+		d->ino_next = pL->ino_hash[d->ino & pL->dir_mask];
+		pL->ino_hash[d->ino & pL->dir_mask] = d;
+	}
+	return 1;
+}
+
+/* first and next frag node of an inode, in list order */
+static struct b_frag_ent *
+jffs2_first_frag(struct b_lists *pL, u32 ino)
+{
+	struct b_frag_ent *f = pL->frag_hash[ino & pL->frag_mask];
+
+	while (f && f->ino != ino)
+		f = f->next;
+	return f;
+}
+
+static struct b_frag_ent *
+jffs2_next_frag(struct b_frag_ent *f)
+{
+	u32 ino = f->ino;
+
+	for (f = f->next; f && f->ino != ino; f = f->next)
+		;
+	return f;
+}
+
 /* find the inode from the slashless name given a parent */
 static long
 jffs2_1pass_read_inode(struct b_lists *pL, u32 inode, char *dest)
 {
-	struct b_node *b;
+	struct b_frag_ent *b;
 	struct jffs2_raw_inode *jNode;
 	u32 totalSize = 0;
 	u32 latestVersion = 0;
@@ -608,7 +805,7 @@ jffs2_1pass_read_inode(struct b_lists *pL, u32 inode, char *dest)
 	 * This shouldn't cause trouble when loading kernel images, so
 	 * we will live with it.
 	 */
-	for (b = pL->frag.listHead; b != NULL; b = b->next) {
+	for (b = jffs2_first_frag(pL, inode); b != NULL; b = jffs2_next_frag(b)) {
 		jNode = (struct jffs2_raw_inode *) get_fl_mem(b->offset,
 		        sizeof(struct jffs2_raw_inode), NULL);
 		if ((inode == jNode->ino)) {
@@ -622,7 +819,7 @@ jffs2_1pass_read_inode(struct b_lists *pL, u32 inode, char *dest)
 	}
 #endif
 
-	for (b = pL->frag.listHead; b != NULL; b = b->next) {
+	for (b = jffs2_first_frag(pL, inode); b != NULL; b = jffs2_next_frag(b)) {
 		jNode = (struct jffs2_raw_inode *) get_node_mem(b->offset);
 		if ((inode == jNode->ino)) {
 #if 0
@@ -716,19 +913,23 @@ jffs2_1pass_read_inode(struct b_lists *pL, u32 inode, char *dest)
 static u32
 jffs2_1pass_find_inode(struct b_lists * pL, const char *name, u32 pino)
 {
-	struct b_node *b;
+	struct b_dirent_ent *b;
 	struct jffs2_raw_dirent *jDir;
 	int len;
 	u32 counter;
 	u32 version = 0;
 	u32 inode = 0;
+	u32 hash;
 
 	/* name is assumed slash free */
 	len = strlen(name);
+	hash = jffs2_name_hash(pino, name, len);
 
 	counter = 0;
 	/* we need to search all and return the inode with the highest version */
-	for(b = pL->dir.listHead; b; b = b->next, counter++) {
+	for(b = pL->name_hash[hash & pL->dir_mask]; b; b = b->name_next, counter++) {
+		if (b->name_hash != hash || b->pino != pino)
+			continue;
 		jDir = (struct jffs2_raw_dirent *) get_node_mem(b->offset);
 		if ((pino == jDir->pino) && (len == jDir->nsize) &&
 		    (jDir->ino) &&	/* 0 for unlink */
@@ -857,7 +1058,7 @@ jffs2_1pass_list_inodes(struct b_lists * pL, u32 pino)
 			u32 i_version = 0;
 			struct jffs2_raw_inode ojNode;
 			struct jffs2_raw_inode *jNode, *i = NULL;
-			struct b_node *b2 = pL->frag.listHead;
+			struct b_frag_ent *b2 = jffs2_first_frag(pL, jDir->ino);
 
 			while (b2) {
 				jNode = (struct jffs2_raw_inode *)
@@ -871,7 +1072,7 @@ jffs2_1pass_list_inodes(struct b_lists * pL, u32 pino)
 					else
 						i = get_fl_mem(b2->offset, sizeof(*i), NULL);
 				}
-				b2 = b2->next;
+				b2 = jffs2_next_frag(b2);
 			}
 
 			dump_inode(pL, jDir, i);
@@ -941,8 +1142,8 @@ jffs2_1pass_search_inode(struct b_lists * pL, const char *fname, u32 pino)
 static u32
 jffs2_1pass_resolve_inode(struct b_lists * pL, u32 ino)
 {
-	struct b_node *b;
-	struct b_node *b2;
+	struct b_dirent_ent *b;
+	struct b_frag_ent *b2;
 	struct jffs2_raw_dirent *jDir;
 	struct jffs2_raw_inode *jNode;
 	u8 jDirFoundType = 0;
@@ -954,7 +1155,9 @@ jffs2_1pass_resolve_inode(struct b_lists * pL, u32 ino)
 	unsigned char *src;
 
 	/* we need to search all and return the inode with the highest version */
-	for(b = pL->dir.listHead; b; b = b->next) {
+	for(b = pL->ino_hash[ino & pL->dir_mask]; b; b = b->ino_next) {
+		if (b->ino != ino)
+			continue;
 		jDir = (struct jffs2_raw_dirent *) get_node_mem(b->offset);
 		if (ino == jDir->ino) {
 			if (jDir->version < version) {
@@ -982,7 +1185,7 @@ jffs2_1pass_resolve_inode(struct b_lists * pL, u32 ino)
 		return jDirFoundIno;
 
 	/* it's a soft link so we follow it again. */
-	b2 = pL->frag.listHead;
+	b2 = jffs2_first_frag(pL, jDirFoundIno);
 	while (b2) {
 		jNode = (struct jffs2_raw_inode *) get_node_mem(b2->offset);
 		if (jNode->ino == jDirFoundIno) {
@@ -999,7 +1202,7 @@ jffs2_1pass_resolve_inode(struct b_lists * pL, u32 ino)
 			put_fl_mem(jNode);
 			break;
 		}
-		b2 = b2->next;
+		b2 = jffs2_next_frag(b2);
 		put_fl_mem(jNode);
 	}
 	/* ok so the name of the new file to find is in tmp */
@@ -1156,6 +1359,356 @@ dump_dirents(struct b_lists *pL)
 }
 #endif
 
+#if defined(CONFIG_JFFS2_SUMMARY) || defined(CONFIG_JFFS2_SCAN_INDEX)
+/*
+ * Erase block size of the partition, 0 if it is unknown or the partition
+ * is not made of equally sized erase blocks.
+ */
+static u32
+jffs2_sector_size(struct part_info *part)
+{
+	struct mtdids *id = part->dev->id;
+	u32 size = 0;
+
+#if defined(CONFIG_CMD_FLASH)
+	if (id->type == MTD_DEV_TYPE_NOR) {
+		extern flash_info_t flash_info[];
+		flash_info_t *flash = &flash_info[id->num];
+		u32 start, end;
+		int i;
+
+		for (i = 0; i < flash->sector_count; i++) {
+			start = flash->start[i] - flash->start[0];
+			if (start < part->offset ||
+			    start >= part->offset + part->size)
+				continue;
+			if (i + 1 < flash->sector_count)
+				end = flash->start[i + 1] - flash->start[0];
+			else
+				end = flash->size;
+			if (size && size != end - start)
+				return 0;
+			size = end - start;
+		}
+	}
+#endif
+
+#if defined(CONFIG_JFFS2_NAND) && defined(CONFIG_CMD_NAND)
+	if (id->type == MTD_DEV_TYPE_NAND) {
+#if defined(CFG_NAND_LEGACY)
+		extern struct nand_chip nand_dev_desc[];
+
+		size = nand_dev_desc[id->num].erasesize;
+#else
+		size = nand_info[id->num].erasesize;
+#endif
+	}
+#endif
+
+	if (size == 0 || part->offset % size || part->size % size)
+		return 0;
+	return size;
+}
+#endif
+
+#ifdef CONFIG_JFFS2_SUMMARY
+/*
+ * Add the nodes of the erase block at 'sector' to the lists using the
+ * summary node at its end instead of reading every node. Node CRCs are
+ * not checked here, the summary itself is.
+ *
+ * Returns 1 if the block was handled, 0 if it has no valid summary and
+ * has to be scanned, -1 if we ran out of memory.
+ */
+static int
+jffs2_sum_scan_block(struct part_info *part, struct b_lists *pL,
+		     u32 sector, u32 sector_size)
+{
+	struct jffs2_sum_marker marker, *sm;
+	struct jffs2_raw_summary *summary;
+	u32 base = part->offset + sector;
+	u32 size, offset;
+	u8 *sp, *end;
+	int i, pass, ret = 0;
+
+	sm = (struct jffs2_sum_marker *) get_fl_mem(base + sector_size -
+			sizeof(marker), sizeof(marker), &marker);
+	if (sm == NULL || sm->magic != JFFS2_SUM_MAGIC ||
+	    sm->offset > sector_size - sizeof(struct jffs2_raw_summary) -
+			 sizeof(marker))
+		return 0;
+
+	summary = (struct jffs2_raw_summary *) get_node_mem(base + sm->offset);
+	if (summary == NULL)
+		return 0;
+	if (summary->magic != JFFS2_MAGIC_BITMASK ||
+	    summary->nodetype != JFFS2_NODETYPE_SUMMARY ||
+	    summary->totlen != sector_size - sm->offset ||
+	    !hdr_crc((struct jffs2_unknown_node *) summary) ||
+	    !sum_node_crc(summary) || !sum_data_crc(summary)) {
+		DEBUGF ("summary: bad summary node at 0x%x\n", base + sm->offset);
+		goto out;
+	}
+
+	/* check all entries first, so a bad one leaves the lists alone */
+	end = (u8 *) summary + summary->totlen - sizeof(marker);
+	for (pass = 0; pass < 2; pass++) {
+		sp = (u8 *) summary->sum;
+		for (i = 0; i < summary->sum_num; i++) {
+			if (sp + sizeof(struct jffs2_sum_unknown_flash) > end)
+				goto out;
+			switch (((struct jffs2_sum_unknown_flash *) sp)->nodetype) {
+			case JFFS2_NODETYPE_INODE:
+				size = sizeof(struct jffs2_sum_inode_flash);
+				offset = ((struct jffs2_sum_inode_flash *) sp)->offset;
+				break;
+			case JFFS2_NODETYPE_DIRENT:
+				size = sizeof(struct jffs2_sum_dirent_flash);
+				if (sp + size <= end)
+					size += ((struct jffs2_sum_dirent_flash *) sp)->nsize;
+				offset = ((struct jffs2_sum_dirent_flash *) sp)->offset;
+				break;
+			case JFFS2_NODETYPE_XATTR:
+				/* xattrs are not supported, skip them */
+				size = sizeof(struct jffs2_sum_xattr_flash);
+				offset = 0;
+				break;
+			case JFFS2_NODETYPE_XREF:
+				size = sizeof(struct jffs2_sum_xref_flash);
+				offset = 0;
+				break;
+			default:
+				printf("Unknown node type in summary: %x offset 0x%x\n",
+					((struct jffs2_sum_unknown_flash *) sp)->nodetype,
+					base + sm->offset);
+				goto out;
+			}
+			if (sp + size > end || offset >= sm->offset)
+				goto out;
+
+			if (pass) {
+				if (((struct jffs2_sum_unknown_flash *) sp)->nodetype ==
+				    JFFS2_NODETYPE_INODE) {
+					if (insert_node(&pL->frag, base + offset) == NULL) {
+						ret = -1;
+						goto out;
+					}
+				} else if (((struct jffs2_sum_unknown_flash *) sp)->nodetype ==
+					   JFFS2_NODETYPE_DIRENT) {
+					if (insert_node(&pL->dir, base + offset) == NULL) {
+						ret = -1;
+						goto out;
+					}
+				}
+			}
+			sp += size;
+		}
+	}
+	ret = 1;
+
+out:
+	put_fl_mem(summary);
+	return ret;
+}
+#endif
+
+#ifdef CONFIG_JFFS2_SCAN_INDEX
+/*
+ * Scan index: the node lists of the last scanned partition, kept in a RAM
+ * area that survives a warm reset. It holds the offset and node CRC of
+ * every dir and frag node and, for every erase block, the end of the
+ * used space. Before it is used again, every node header is checked to
+ * be still in place and unchanged (so nodes obsoleted or erased since
+ * are noticed), and every block to be still erased after its used space
+ * (so nodes written since are noticed). That is much cheaper than a
+ * scan, which has to read and checksum all data.
+ */
+#if !defined(CFG_JFFS2_INDEX_ADDR) || !defined(CFG_JFFS2_INDEX_SIZE)
+#error "CONFIG_JFFS2_SCAN_INDEX needs CFG_JFFS2_INDEX_ADDR and CFG_JFFS2_INDEX_SIZE"
+#endif
+
+#define JFFS2_INDEX_MAGIC	0x4a324958	/* "J2IX" */
+
+struct jffs2_index_hdr {
+	u32 magic;
+	u32 hdr_crc;		/* of the rest of this header */
+	u32 crc;		/* of everything after this header */
+	u32 len;		/* bytes after this header */
+	u32 dev;		/* device type << 8 | device number */
+	u32 offset;		/* partition offset and size */
+	u32 size;
+	u32 sector_size;
+	u32 dir_count;
+	u32 frag_count;
+	/* u32 used[size / sector_size]; end of used space in each block */
+	/* struct jffs2_index_node dir[dir_count]; */
+	/* struct jffs2_index_node frag[frag_count]; */
+};
+
+struct jffs2_index_node {
+	u32 offset;
+	u32 node_crc;		/* covers ino and version too */
+};
+
+#define jffs2_index_mark(used, sector_size, start, end)		\
+	do {								\
+		if (used)						\
+			(used)[(start) / (sector_size)] = (end);	\
+	} while (0)
+
+static u32
+jffs2_index_dev(struct part_info *part)
+{
+	return part->dev->id->type << 8 | part->dev->id->num;
+}
+
+/* node CRC of the dir or frag node at offset, 0 if it is not one any more */
+static u32
+jffs2_index_node_crc(u32 offset, int dirent)
+{
+	union jffs2_node_union onode, *node;
+
+	node = (union jffs2_node_union *) get_fl_mem(offset, dirent ?
+			sizeof(struct jffs2_raw_dirent) :
+			sizeof(struct jffs2_raw_inode), &onode);
+	if (node == NULL || node->u.magic != JFFS2_MAGIC_BITMASK)
+		return 0;
+	if (dirent && node->u.nodetype == JFFS2_NODETYPE_DIRENT)
+		return node->d.node_crc;
+	if (!dirent && node->u.nodetype == JFFS2_NODETYPE_INODE)
+		return node->i.node_crc;
+	return 0;
+}
+
+/*
+ * Copy a list into the index, leaving out nodes that have been marked
+ * obsolete (a summary still lists them). Returns the number of entries.
+ */
+static u32
+jffs2_index_fill(struct jffs2_index_node *in, struct b_list *list, int dirent)
+{
+	struct b_node *b;
+	u32 n = 0;
+
+	for (b = list->listHead; b; b = b->next) {
+		in[n].offset = b->offset;
+		in[n].node_crc = jffs2_index_node_crc(b->offset, dirent);
+		if (in[n].node_crc != 0)
+			n++;
+	}
+	return n;
+}
+
+static void
+jffs2_index_save(struct part_info *part, struct b_lists *pL,
+		 u32 *used, u32 sector_size)
+{
+	struct jffs2_index_hdr *hdr = (struct jffs2_index_hdr *) CFG_JFFS2_INDEX_ADDR;
+	struct jffs2_index_node *in;
+	u32 nblocks = part->size / sector_size;
+	u32 len;
+
+	hdr->magic = 0;
+	len = nblocks * sizeof(u32) + (pL->dir.listCount + pL->frag.listCount) *
+		sizeof(struct jffs2_index_node);
+	if (sizeof(*hdr) + len > CFG_JFFS2_INDEX_SIZE) {
+		printf("JFFS2 scan index too big (%zu bytes), not saved\n",
+			sizeof(*hdr) + len);
+		return;
+	}
+
+	memcpy(hdr + 1, used, nblocks * sizeof(u32));
+	in = (struct jffs2_index_node *) ((u32 *) (hdr + 1) + nblocks);
+	hdr->dir_count = jffs2_index_fill(in, &pL->dir, 1);
+	hdr->frag_count = jffs2_index_fill(in + hdr->dir_count, &pL->frag, 0);
+
+	hdr->len = nblocks * sizeof(u32) + (hdr->dir_count + hdr->frag_count) *
+		sizeof(struct jffs2_index_node);
+	hdr->crc = crc32(0, (unsigned char *) (hdr + 1), hdr->len);
+	hdr->dev = jffs2_index_dev(part);
+	hdr->offset = part->offset;
+	hdr->size = part->size;
+	hdr->sector_size = sector_size;
+	hdr->hdr_crc = crc32(0, (unsigned char *) &hdr->crc,
+			     sizeof(*hdr) - 2 * sizeof(u32));
+	hdr->magic = JFFS2_INDEX_MAGIC;
+}
+
+/*
+ * Build the lists from the scan index. Returns 1 on success, 0 if there
+ * is no index for this partition or it does not match the flash.
+ */
+static u32
+jffs2_index_load(struct part_info *part)
+{
+	struct jffs2_index_hdr *hdr = (struct jffs2_index_hdr *) CFG_JFFS2_INDEX_ADDR;
+	struct jffs2_index_node *in;
+	struct b_lists *pL;
+	ulong start = get_timer(0);
+	u32 *used, word, end;
+	u32 i, n;
+
+	if (hdr->magic != JFFS2_INDEX_MAGIC ||
+	    hdr->hdr_crc != crc32(0, (unsigned char *) &hdr->crc,
+				  sizeof(*hdr) - 2 * sizeof(u32)) ||
+	    hdr->dev != jffs2_index_dev(part) ||
+	    hdr->offset != part->offset || hdr->size != part->size ||
+	    hdr->sector_size == 0 ||
+	    hdr->sector_size != jffs2_sector_size(part) ||
+	    hdr->len > CFG_JFFS2_INDEX_SIZE - sizeof(*hdr) ||
+	    hdr->crc != crc32(0, (unsigned char *) (hdr + 1), hdr->len))
+		return 0;
+
+	puts ("Checking JFFS2 scan index: ");
+
+	/* nothing written after the used space of each block */
+	used = (u32 *) (hdr + 1);
+	for (i = 0; i < hdr->size / hdr->sector_size; i++) {
+		end = (i + 1) * hdr->sector_size;
+		if (used[i] >= end)
+			continue;
+		if (*(u32 *) get_fl_mem(part->offset + used[i], sizeof(word),
+					&word) != 0xFFFFFFFF)
+			goto stale;
+		WATCHDOG_RESET();
+	}
+
+	/* and every node still in place */
+	in = (struct jffs2_index_node *) (used + i);
+	n = hdr->dir_count + hdr->frag_count;
+	for (i = 0; i < n; i++) {
+		if (jffs2_index_node_crc(in[i].offset, i < hdr->dir_count) !=
+		    in[i].node_crc)
+			goto stale;
+		if ((i & 0xff) == 0)
+			WATCHDOG_RESET();
+	}
+
+	jffs_init_1pass_list(part);
+	pL = (struct b_lists *)part->jffs2_priv;
+	if (pL == NULL)
+		return 0;
+	for (i = 0; i < n; i++) {
+		if (insert_node(i < hdr->dir_count ? &pL->dir : &pL->frag,
+				in[i].offset) == NULL) {
+			jffs2_free_cache(part);
+			part->jffs2_priv = NULL;
+			return 0;
+		}
+	}
+	pL->scan_time = get_timer(start);
+	puts ("done.\n");
+	return 1;
+
+stale:
+	puts ("stale.\n");
+	hdr->magic = 0;
+	return 0;
+}
+#else
+#define jffs2_index_mark(used, sector_size, start, end)
+#endif
+
 static u32
 jffs2_1pass_build_lists(struct part_info * part)
 {
@@ -1167,6 +1720,18 @@ jffs2_1pass_build_lists(struct part_info * part)
 	u32 counter4 = 0;
 	u32 counterF = 0;
 	u32 counterN = 0;
+	ulong start = get_timer(0);
+#if defined(CONFIG_JFFS2_SUMMARY) || defined(CONFIG_JFFS2_SCAN_INDEX)
+	u32 sector_size;
+#endif
+#ifdef CONFIG_JFFS2_SUMMARY
+	u32 sector_end = 0;
+	int ret;
+#endif
+#ifdef CONFIG_JFFS2_SCAN_INDEX
+	u32 *used = NULL;
+	u32 i;
+#endif
 
 	/* turn off the lcd.  Refreshing the lcd adds 50% overhead to the */
 	/* jffs2 list building enterprise nope.  in newer versions the overhead is */
@@ -1177,7 +1742,20 @@ jffs2_1pass_build_lists(struct part_info * part)
 	jffs_init_1pass_list(part);
 	pL = (struct b_lists *)part->jffs2_priv;
 	offset = 0;
+#if defined(CONFIG_JFFS2_NAND) && defined(CONFIG_CMD_NAND)
+	nand_cache_hits = nand_cache_misses = nand_cache_reads = 0;
+#endif
 	puts ("Scanning JFFS2 FS:   ");
+#if defined(CONFIG_JFFS2_SUMMARY) || defined(CONFIG_JFFS2_SCAN_INDEX)
+	sector_size = jffs2_sector_size(part);
+#endif
+#ifdef CONFIG_JFFS2_SCAN_INDEX
+	if (sector_size &&
+	    (used = malloc(part->size / sector_size * sizeof(u32))) != NULL) {
+		for (i = 0; i < part->size / sector_size; i++)
+			used[i] = i * sector_size;
+	}
+#endif
 
 	/* start at the beginning of the partition */
 	while (offset < max) {
@@ -1188,6 +1766,25 @@ jffs2_1pass_build_lists(struct part_info * part)
 
 		WATCHDOG_RESET();
 
+#ifdef CONFIG_JFFS2_SUMMARY
+		/* entering a new erase block: try its summary first */
+		if (sector_size && offset >= sector_end) {
+			sector_end = offset - offset % sector_size + sector_size;
+			ret = jffs2_sum_scan_block(part, pL,
+					sector_end - sector_size, sector_size);
+			if (ret < 0)
+				goto fail;
+			if (ret) {
+				pL->sum_blocks++;
+				jffs2_index_mark(used, sector_size,
+						 offset, sector_end);
+				offset = sector_end;
+				continue;
+			}
+			pL->scan_blocks++;
+		}
+#endif
+
 		node = (struct jffs2_unknown_node *) get_node_mem((u32)part->offset + offset);
 		if (node->magic == JFFS2_MAGIC_BITMASK && hdr_crc(node)) {
 			/* if its a fragment add it */
@@ -1197,7 +1794,7 @@ jffs2_1pass_build_lists(struct part_info * part)
 				if (insert_node(&pL->frag, (u32) part->offset +
 						offset) == NULL) {
 					put_fl_mem(node);
-					return 0;
+					goto fail;
 				}
 			} else if (node->nodetype == JFFS2_NODETYPE_DIRENT &&
 				   dirent_crc((struct jffs2_raw_dirent *) node)  &&
@@ -1207,7 +1804,7 @@ jffs2_1pass_build_lists(struct part_info * part)
 				if (insert_node(&pL->dir, (u32) part->offset +
 						offset) == NULL) {
 					put_fl_mem(node);
-					return 0;
+					goto fail;
 				}
 				counterN++;
 			} else if (node->nodetype == JFFS2_NODETYPE_CLEANMARKER) {
@@ -1222,17 +1819,22 @@ jffs2_1pass_build_lists(struct part_info * part)
 						"%d < %zu\n",
 						node->totlen,
 						sizeof(struct jffs2_unknown_node));
+			} else if (node->nodetype == JFFS2_NODETYPE_SUMMARY) {
+				/* nothing in there we did not see already */
 			} else {
 				printf("Unknown node type: %x len %d offset 0x%x\n",
 					node->nodetype,
 					node->totlen, offset);
 			}
+			jffs2_index_mark(used, sector_size, offset,
+					 offset + ((node->totlen + 3) & ~3));
 			offset += ((node->totlen + 3) & ~3);
 			counterF++;
 		} else if (node->magic == JFFS2_EMPTY_BITMASK &&
 			   node->nodetype == JFFS2_EMPTY_BITMASK) {
 			offset = jffs2_scan_empty(offset, part);
 		} else {	/* if we know nothing, we just step and look. */
+			jffs2_index_mark(used, sector_size, offset, offset + 4);
 			offset += 4;
 			counter4++;
 		}
@@ -1240,7 +1842,14 @@ jffs2_1pass_build_lists(struct part_info * part)
 		put_fl_mem(node);
 	}
 
+	pL->scan_time = get_timer(start);
 	putstr("\b\b done.\r\n");		/* close off the dots */
+#ifdef CONFIG_JFFS2_SCAN_INDEX
+	if (used) {
+		jffs2_index_save(part, pL, used, sector_size);
+		free(used);
+	}
+#endif
 	/* turn the lcd back on. */
 	/* splash(); */
 
@@ -1263,6 +1872,13 @@ jffs2_1pass_build_lists(struct part_info * part)
 	/* give visual feedback that we are done scanning the flash */
 	led_blink(0x0, 0x0, 0x1, 0x1);	/* off, forever, on 100ms, off 100ms */
 	return 1;
+
+fail:
+#ifdef CONFIG_JFFS2_SCAN_INDEX
+	if (used)
+		free(used);
+#endif
+	return 0;
 }
 
 
@@ -1302,10 +1918,21 @@ jffs2_get_list(struct part_info * part, const char *who)
 	current_part = part;
 
 	if (jffs2_1pass_rescan_needed(part)) {
-		if (!jffs2_1pass_build_lists(part)) {
+		u32 ok = 0;
+
+#ifdef CONFIG_JFFS2_SCAN_INDEX
+		ok = jffs2_index_load(part);
+#endif
+		if (!ok && !jffs2_1pass_build_lists(part)) {
 			printf("%s: Failed to scan JFFSv2 file structure\n", who);
 			return NULL;
 		}
+		if (!jffs2_1pass_build_hash((struct b_lists *)part->jffs2_priv)) {
+			printf("%s: Failed to index JFFSv2 file structure\n", who);
+			jffs2_free_cache(part);
+			part->jffs2_priv = NULL;
+			return NULL;
+		}
 	}
 	return (struct b_lists *)part->jffs2_priv;
 }
@@ -1392,6 +2019,17 @@ jffs2_1pass_info(struct part_info * part)
 			info.compr_info[i].compr_sum,
 			info.compr_info[i].decompr_sum);
 	}
+	printf ("Scan time: %lu.%03lu s\n", pl->scan_time / CFG_HZ,
+		(pl->scan_time % CFG_HZ) * 1000 / CFG_HZ);
+#ifdef CONFIG_JFFS2_SUMMARY
+	printf ("Erase blocks: %d from summary, %d scanned\n",
+		pl->sum_blocks, pl->scan_blocks);
+#endif
+#if defined(CONFIG_JFFS2_NAND) && defined(CONFIG_CMD_NAND)
+	if (part->dev->id->type == MTD_DEV_TYPE_NAND)
+		printf ("NAND cache: %u hits, %u misses, %u NAND reads\n",
+			nand_cache_hits, nand_cache_misses, nand_cache_reads);
+#endif
 	return 1;
 }
 
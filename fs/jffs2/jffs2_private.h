@@ -21,10 +21,37 @@ struct b_list {
 	struct mem_block *listMemBase;
 };
 
+/* hash index over the lists, entries are chained in list order */
+struct b_frag_ent {
+	u32 offset;
+	u32 ino;
+	struct b_frag_ent *next;	/* same ino bucket */
+};
+
+struct b_dirent_ent {
+	u32 offset;
+	u32 pino;
+	u32 ino;
+	u32 name_hash;			/* of pino and name */
+	struct b_dirent_ent *name_next;	/* same name_hash bucket */
+	struct b_dirent_ent *ino_next;	/* same ino bucket */
+};
+
 struct b_lists {
 	struct b_list dir;
 	struct b_list frag;
-
+	struct b_frag_ent *frags;
+	struct b_frag_ent **frag_hash;
+	u32 frag_mask;
+	struct b_dirent_ent *dirents;
+	struct b_dirent_ent **name_hash;
+	struct b_dirent_ent **ino_hash;
+	u32 dir_mask;
+	ulong scan_time;	/* in timer ticks */
+#ifdef CONFIG_JFFS2_SUMMARY
+	u32 sum_blocks;		/* erase blocks built from their summary */
+	u32 scan_blocks;	/* erase blocks scanned node by node */
+#endif
 };
 
 struct b_compr_info {
@@ -97,4 +124,25 @@ data_crc(struct jffs2_raw_inode *node)
 	}
 }
 
+static inline int
+sum_node_crc(struct jffs2_raw_summary *node)
+{
+	if (node->node_crc != crc32_no_comp(0, (unsigned char *)node, sizeof(struct jffs2_raw_summary) - 8)) {
+		return 0;
+	} else {
+		return 1;
+	}
+}
+
+static inline int
+sum_data_crc(struct jffs2_raw_summary *node)
+{
+	if (node->sum_crc != crc32_no_comp(0, (unsigned char *)node->sum,
+					   node->totlen - sizeof(struct jffs2_raw_summary))) {
+		return 0;
+	} else {
+		return 1;
+	}
+}
+
 #endif /* jffs2_private.h */
@@ -124,6 +124,12 @@ extern void set_GPIO_mode( int gpio_mode );
  */
 extern unsigned int get_lclk_frequency_10khz(void);
 
+/*
+ * Polled memory to memory DMA on one channel (cpu/pxa/dma.c)
+ */
+extern int pxa_dma_xfer(int chan, unsigned long src, unsigned long dst,
+			unsigned long len, unsigned long dcmd);
+
 #endif
 
 
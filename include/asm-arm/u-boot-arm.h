@@ -46,6 +46,14 @@ int	dram_init (void);
 void	setup_serial_tag (struct tag **params);
 void	setup_revision_tag (struct tag **params);
 
+/* lib_arm/cksum.S */
+#define __HAVE_ARCH_NETCKSUM	/* replaces NetCksum() in net/cksum.c */
+
+/* lib_arm/crc32.S */
+#ifdef CONFIG_CRC32_SLICE8
+#define __HAVE_ARCH_CRC32_SLICE8 /* replaces crc32_slice8() in lib_generic/crc32.c */
+#endif
+
 /* ------------------------------------------------------------ */
 /* Here is a list of some prototypes which are incompatible to	*/
 /* the U-Boot implementation					*/
@@ -0,0 +1,59 @@
+/*
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * Binary BCH codes over GF(2^m), see lib_generic/bch.c
+ */
+
+#ifndef _BCH_H_
+#define _BCH_H_
+
+#define BCH_MAX_M	13
+#define BCH_MAX_T	16
+
+struct bch_control {
+	int		m;		/* GF(2^m) */
+	int		n;		/* 2^m - 1, the full code length */
+	int		t;		/* correctable bit errors */
+	int		ecc_bits;	/* degree of the generator polynomial */
+	int		ecc_bytes;
+	int		ecc_words;	/* 32 bit words of the encoder register */
+	uint16_t	*a_pow;		/* a_pow[i] = alpha^i */
+	uint16_t	*a_log;		/* a_log[alpha^i] = i */
+	uint32_t	*mod_tab;	/* x^ecc_bits * byte mod g(x), 256 entries */
+};
+
+/*
+ * init_bch() returns NULL if m or t is out of range or no memory is
+ * left. encode_bch() writes ecc_bytes bytes. decode_bch() takes the
+ * encode_bch() result for data in calc_ecc, or NULL to compute it, and
+ * returns the number of errors found with their bit positions in
+ * errloc (byte offset * 8 + bit, positions >= len * 8 are in the ECC
+ * bytes), or -1 if the data can not be corrected.
+ */
+struct bch_control *init_bch (int m, int t);
+void free_bch (struct bch_control *bch);
+void encode_bch (struct bch_control *bch, const uint8_t *data,
+		 unsigned int len, uint8_t *ecc);
+int decode_bch (struct bch_control *bch, const uint8_t *data,
+		unsigned int len, const uint8_t *recv_ecc,
+		const uint8_t *calc_ecc, unsigned int *errloc);
+
+#endif /* _BCH_H_ */
@@ -617,6 +617,15 @@ int	vsprintf(char *buf, const char *fmt, va_list args);
 uint32_t crc32 (uint32_t, const unsigned char *, uint);
 uint32_t crc32_wd (uint32_t, const unsigned char *, uint, uint);
 uint32_t crc32_no_comp (uint32_t, const unsigned char *, uint);
+uint32_t crc32_copy_wd (uint32_t, unsigned char *, const unsigned char *,
+			uint, uint);
+
+/* common/gunzip.c */
+#ifdef CONFIG_GUNZIP_STREAM
+int	gunzip_stream_start(void *dst, int dstlen);
+int	gunzip_stream_feed(unsigned char *src, unsigned long len);
+int	gunzip_stream_end(unsigned long *lenp);
+#endif
 
 /* common/console.c */
 int	console_init_f(void);	/* Before relocation; uses the serial  stuff	*/
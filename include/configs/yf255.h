@@ -57,6 +57,8 @@
 #define CONFIG_DRIVER_LAN91C113 //zkj
 #define CONFIG_SMC91111_BASE (PXA_CS3_PHYS+0x300) //zkj
 #define CONFIG_SMC_USE_32_BIT	1
+#define CONFIG_SMC_RX_BURST	1	/* drain the RX FIFO on every poll */
+#define CFG_RX_ETH_BUFFER	8	/* receive ring for burst receive */
 
 /*
  * select serial console configuration
@@ -87,6 +89,12 @@
 //#define CONFIG_CMD_FAT
 #define CONFIG_CMD_NET
 #define CONFIG_CMD_PING
+#define CONFIG_CMD_FLUPDATE
+
+#define CONFIG_GUNZIP_STREAM		/* tftpboot -z */
+#define CONFIG_IP_DEFRAG		/* allow tftpblocksize > MTU */
+#define CONFIG_NET_MAXDEFRAG	65515	/* largest IP payload */
+#define CONFIG_CRC32_SLICE8		/* faster image/env CRC checks */
 
 
 #define CONFIG_BOOTDELAY	3
@@ -285,6 +293,13 @@
 /* timeout values are in ticks */
 #define CFG_FLASH_ERASE_TOUT	(25*CFG_HZ) /* Timeout for Flash Erase */
 #define CFG_FLASH_WRITE_TOUT	(25*CFG_HZ) /* Timeout for Flash Write */
+#define CFG_FLASH_USE_BUFFER_WRITE	/* program through the 32 byte write buffer */
+
+/* tftp straight into flash, erasing ahead while 2 MB are staged in RAM */
+#define CFG_DIRECT_FLASH_TFTP
+#define CFG_FLASH_ASYNC_ERASE
+#define CFG_TFTP_FLASH_RING_ADDR	(PHYS_SDRAM_1 + 0x01000000)
+#define CFG_TFTP_FLASH_RING_SIZE	0x00200000
 
 /* NOTE: many default partitioning schemes assume the kernel starts at the
  * second sector, not an environment.  You have been warned!
@@ -120,4 +120,7 @@ void env_crc_update (void);
 /* [re]set to the default environment */
 void set_default_env(void);
 
+/* Build the getenv() hash index, see cmd_nvedit.c */
+void env_hash_init(void);
+
 #endif	/* _ENVIRONMENT_H_ */
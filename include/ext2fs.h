@@ -79,3 +79,6 @@ extern int ext2fs_open (char *filename);
 extern int ext2fs_read (char *buf, unsigned len);
 extern int ext2fs_mount (unsigned part_length);
 extern int ext2fs_close(void);
+
+/* device reads done by the last ext2fs_read(), for debugging */
+extern unsigned long ext2fs_devread_cnt;
@@ -43,7 +43,15 @@
 #define DIRENTSPERBLOCK	(FS_BLOCK_SIZE/sizeof(dir_entry))
 #define DIRENTSPERCLUST	((mydata->clust_size*SECTOR_SIZE)/sizeof(dir_entry))
 
-#define FATBUFBLOCKS	6
+/* FAT cache size in sectors, a multiple of 3 so FAT12 entries don't straddle */
+#ifdef CFG_FAT_BUFBLOCKS
+#define FATBUFBLOCKS	CFG_FAT_BUFBLOCKS
+#else
+#define FATBUFBLOCKS	24
+#endif
+#if FATBUFBLOCKS % 3
+#error CFG_FAT_BUFBLOCKS must be a multiple of 3
+#endif
 #define FATBUFSIZE	(FS_BLOCK_SIZE*FATBUFBLOCKS)
 #define FAT12BUFSIZE	((FATBUFSIZE*2)/3)
 #define FAT16BUFSIZE	(FATBUFSIZE/2)
@@ -182,16 +190,40 @@ typedef struct dir_slot {
  * (see FAT32 accesses)
  */
 typedef struct {
-	__u8	fatbuf[FATBUFSIZE]; /* Current FAT buffer */
+	__u8	*fatbuf;	/* Current FAT buffer */
 	int	fatsize;	/* Size of FAT in bits */
-	__u16	fatlength;	/* Length of FAT in sectors */
-	__u16	fat_sect;	/* Starting sector of the FAT */
-	__u16	rootdir_sect;	/* Start sector of root directory */
+	__u32	fatlength;	/* Length of FAT in sectors */
+	__u32	fat_sect;	/* Starting sector of the FAT */
+	__u32	rootdir_sect;	/* Start sector of root directory */
 	__u16	clust_size;	/* Size of clusters in sectors */
-	short	data_begin;	/* The sector of the first cluster, can be negative */
+	int	data_begin;	/* The sector of the first cluster, can be negative */
 	int	fatbufnum;	/* Used by get_fatent, init to -1 */
+#ifdef CONFIG_FAT_WRITE
+	int	fats;		/* Number of FAT copies */
+	int	fatdirty_first;	/* Modified sectors of fatbuf, -1 if none */
+	int	fatdirty_last;
+#endif
 } fsdata;
 
+/* Directory entry cache */
+#ifndef CFG_FAT_DCACHE_SIZE
+#define CFG_FAT_DCACHE_SIZE	16
+#endif
+#define FAT_DCACHE_NAMELEN	64
+
+typedef struct {
+	__u32	parent;		/* Start cluster of directory, 0 for root */
+	unsigned long lru;	/* 0 if unused */
+	char	name[FAT_DCACHE_NAMELEN]; /* Lower case name */
+	dir_entry dent;		/* The entry found */
+} fat_dcache_ent;
+
+/* A run of consecutive clusters */
+typedef struct {
+	__u32	start;		/* First cluster */
+	__u32	count;		/* Number of clusters */
+} fat_extent;
+
 typedef int	(file_detectfs_func)(void);
 typedef int	(file_ls_func)(const char *dir);
 typedef long	(file_read_func)(const char *filename, void *buffer,
@@ -214,6 +246,9 @@ int file_cd(const char *path);
 int file_fat_detectfs(void);
 int file_fat_ls(const char *dir);
 long file_fat_read(const char *filename, void *buffer, unsigned long maxsize);
+#ifdef CONFIG_FAT_WRITE
+long file_fat_write(const char *filename, void *buffer, unsigned long size);
+#endif
 const char *file_getfsname(int idx);
 int fat_register_device(block_dev_desc_t *dev_desc, int part_no);
 
@@ -99,6 +99,10 @@ extern flash_info_t *addr2info (ulong);
 extern int write_buff (flash_info_t *info, uchar *src, ulong addr, ulong cnt);
 
 /* board/?/flash.c */
+#if defined(CFG_FLASH_ASYNC_ERASE)
+extern int flash_erase_start (flash_info_t *info, int sect);
+extern int flash_erase_poll (flash_info_t *info, int sect);
+#endif	/* CFG_FLASH_ASYNC_ERASE */
 #if defined(CFG_FLASH_PROTECTION)
 extern int flash_real_protect(flash_info_t *info, long sector, int prot);
 extern void flash_read_user_serial(flash_info_t * info, void * buffer, int offset, int len);
@@ -220,6 +220,7 @@ typedef struct bootm_headers {
 #endif
 
 	int		verify;		/* getenv("verify")[0] != 'n' */
+	int		verify_load;	/* verify while copying to load addr */
 	struct lmb	*lmb;		/* for memory mgmt */
 } bootm_headers_t;
 
@@ -545,6 +546,7 @@ int fit_image_hash_set_value (void *fit, int noffset, uint8_t *value,
 				int value_len);
 
 int fit_image_check_hashes (const void *fit, int noffset);
+int fit_image_copy_check_hashes (const void *fit, int noffset, void *dst);
 int fit_image_check_os (const void *fit, int noffset, uint8_t os);
 int fit_image_check_arch (const void *fit, int noffset, uint8_t arch);
 int fit_image_check_type (const void *fit, int noffset, uint8_t type);
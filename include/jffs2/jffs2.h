@@ -89,6 +89,12 @@
 #define JFFS2_NODETYPE_INODE (JFFS2_FEATURE_INCOMPAT | JFFS2_NODE_ACCURATE | 2)
 #define JFFS2_NODETYPE_CLEANMARKER (JFFS2_FEATURE_RWCOMPAT_DELETE | JFFS2_NODE_ACCURATE | 3)
 #define JFFS2_NODETYPE_PADDING (JFFS2_FEATURE_RWCOMPAT_DELETE | JFFS2_NODE_ACCURATE | 4)
+#define JFFS2_NODETYPE_SUMMARY (JFFS2_FEATURE_RWCOMPAT_DELETE | JFFS2_NODE_ACCURATE | 6)
+#define JFFS2_NODETYPE_XATTR (JFFS2_FEATURE_INCOMPAT | JFFS2_NODE_ACCURATE | 8)
+#define JFFS2_NODETYPE_XREF (JFFS2_FEATURE_INCOMPAT | JFFS2_NODE_ACCURATE | 9)
+
+/* Erase block summary marker, the last 8 bytes of a summed erase block */
+#define JFFS2_SUM_MAGIC 0x02851885
 
 /* Maybe later... */
 /*#define JFFS2_NODETYPE_CHECKPOINT (JFFS2_FEATURE_RWCOMPAT_DELETE | JFFS2_NODE_ACCURATE | 3) */
@@ -166,6 +172,73 @@ struct jffs2_raw_inode
 /*	__u8 data[dsize]; */
 } __attribute__((packed));
 
+/* Erase block summary (EBS) node, written by mkfs.jffs2 or sumtool at the
+   end of an erase block. It lists the inode and dirent nodes of the block
+   so that the block need not be scanned.
+*/
+struct jffs2_raw_summary
+{
+	__u16 magic;
+	__u16 nodetype;	/* == JFFS2_NODETYPE_SUMMARY */
+	__u32 totlen;	/* up to the end of the erase block */
+	__u32 hdr_crc;
+	__u32 sum_num;	/* number of summary entries */
+	__u32 cln_mkr;	/* clean marker size, 0 = no cleanmarker */
+	__u32 padded;	/* sum of the size of padding nodes */
+	__u32 sum_crc;	/* CRC of everything after this header */
+	__u32 node_crc;	/* CRC of this header */
+	__u32 sum[0];	/* summary entries */
+} __attribute__((packed));
+
+/* Summary entries, all offsets are relative to the erase block start */
+struct jffs2_sum_unknown_flash
+{
+	__u16 nodetype;
+} __attribute__((packed));
+
+struct jffs2_sum_inode_flash
+{
+	__u16 nodetype;	/* == JFFS2_NODETYPE_INODE */
+	__u32 inode;
+	__u32 version;
+	__u32 offset;
+	__u32 totlen;
+} __attribute__((packed));
+
+struct jffs2_sum_dirent_flash
+{
+	__u16 nodetype;	/* == JFFS2_NODETYPE_DIRENT */
+	__u32 totlen;
+	__u32 offset;
+	__u32 pino;
+	__u32 version;
+	__u32 ino;
+	__u8 nsize;
+	__u8 type;
+	__u8 name[0];
+} __attribute__((packed));
+
+struct jffs2_sum_xattr_flash
+{
+	__u16 nodetype;	/* == JFFS2_NODETYPE_XATTR */
+	__u32 xid;
+	__u32 version;
+	__u32 offset;
+	__u32 totlen;
+} __attribute__((packed));
+
+struct jffs2_sum_xref_flash
+{
+	__u16 nodetype;	/* == JFFS2_NODETYPE_XREF */
+	__u32 offset;
+} __attribute__((packed));
+
+struct jffs2_sum_marker
+{
+	__u32 offset;	/* of the summary node within the erase block */
+	__u32 magic;	/* == JFFS2_SUM_MAGIC */
+} __attribute__((packed));
+
 union jffs2_node_union {
 	struct jffs2_raw_inode i;
 	struct jffs2_raw_dirent d;
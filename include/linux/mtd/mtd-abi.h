@@ -93,7 +93,7 @@ struct nand_oobinfo {
 	uint32_t useecc;
 	uint32_t eccbytes;
 	uint32_t oobfree[8][2];
-	uint32_t eccpos[48];
+	uint32_t eccpos[64];
 };
 
 #endif /* __MTD_ABI_H__ */
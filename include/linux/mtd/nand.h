@@ -135,6 +135,10 @@ extern int nand_read_raw (struct mtd_info *mtd, uint8_t *buf, loff_t from, size_
 #define NAND_ECC_HW8_512	6
 /* Hardware ECC 12 byte ECC per 2048 Byte data */
 #define NAND_ECC_HW12_2048	7
+/* Software ECC 3 byte ECC per 512 Byte data */
+#define NAND_ECC_SOFT_512	8
+/* Software BCH ECC, CFG_NAND_BCH_T bit errors per 512 Byte data */
+#define NAND_ECC_SOFT_BCH	9
 
 /*
  * Constants for Hardware ECC
@@ -187,6 +191,12 @@ extern int nand_read_raw (struct mtd_info *mtd, uint8_t *buf, loff_t from, size_
  * This can only work if we have the ecc bytes directly behind the
  * data bytes. Applies for DOC and AG-AND Renesas HW Reed Solomon generators */
 #define NAND_HWECC_SYNDROME	0x00020000
+/* 32 bit accesses to IO_ADDR_R/W are split by the bus into bus width
+ * cycles, so the buffer functions may move a word per access */
+#define NAND_WORD_IO		0x00040000
+/* Like NAND_WORD_IO, and the data port decodes at least 16 bytes of
+ * address space, so ldm/stm bursts of four words can be used */
+#define NAND_BURST_IO		(0x00080000 | NAND_WORD_IO)
 
 
 /* Options set by nand scan */
@@ -235,6 +245,9 @@ struct nand_hw_control {
  * @write_buf:		[REPLACEABLE] write data from the buffer to the chip
  * @read_buf:		[REPLACEABLE] read data from the chip into the buffer
  * @verify_buf:		[REPLACEABLE] verify buffer contents against the chip data
+ * @dma_xfer:		[BOARDSPECIFIC] move len bytes between buf and the data port by DMA
+ *			(write != 0: to the chip). Returns 0 when done, anything else makes the
+ *			default buffer functions do the transfer themselves
  * @select_chip:	[REPLACEABLE] select chip nr
  * @block_bad:		[REPLACEABLE] check, if the block is bad
  * @block_markbad:	[REPLACEABLE] mark the block bad
@@ -294,6 +307,7 @@ struct nand_chip {
 	void		(*write_buf)(struct mtd_info *mtd, const u_char *buf, int len);
 	void		(*read_buf)(struct mtd_info *mtd, u_char *buf, int len);
 	int		(*verify_buf)(struct mtd_info *mtd, const u_char *buf, int len);
+	int		(*dma_xfer)(struct mtd_info *mtd, u_char *buf, int len, int write);
 	void		(*select_chip)(struct mtd_info *mtd, int chip);
 	int		(*block_bad)(struct mtd_info *mtd, loff_t ofs, int getchip);
 	int		(*block_markbad)(struct mtd_info *mtd, loff_t ofs);
@@ -27,4 +27,12 @@ int nand_calculate_ecc(struct mtd_info *mtd, const u_char *dat, u_char *ecc_code
  */
 int nand_correct_data(struct mtd_info *mtd, u_char *dat, u_char *read_ecc, u_char *calc_ecc);
 
+/*
+ * BCH ECC over 512 byte blocks (NAND_ECC_SOFT_BCH): nand_bch_init()
+ * returns the number of ECC bytes per block, or -1
+ */
+int nand_bch_init(struct mtd_info *mtd);
+int nand_bch_calculate_ecc(struct mtd_info *mtd, const u_char *dat, u_char *ecc_code);
+int nand_bch_correct_data(struct mtd_info *mtd, u_char *dat, u_char *read_ecc, u_char *calc_ecc);
+
 #endif /* __MTD_NAND_ECC_H__ */
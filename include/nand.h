@@ -112,6 +112,31 @@ int nand_write_opts(nand_info_t *meminfo, const nand_write_options_t *opts);
 int nand_read_opts(nand_info_t *meminfo, const nand_read_options_t *opts);
 int nand_erase_opts(nand_info_t *meminfo, const nand_erase_options_t *opts);
 
+/*
+ * Sequential reader over the good blocks of [start, end): each erase
+ * block is looked up in the BBT once, runs of good blocks are read
+ * with one read call.
+ */
+struct nand_stream {
+	nand_info_t *nand;
+	ulong start;		/* first block of the range */
+	ulong skip;		/* start offset within the first block */
+	ulong end;
+	ulong *map;		/* offsets of the good blocks found so far */
+	int nmap;		/* entries in map */
+	int maxmap;		/* blocks in [start, end) */
+	ulong next;		/* next block to look up */
+	ulong pos;		/* bytes read so far */
+	int quiet;		/* don't report skipped bad blocks */
+};
+
+typedef struct nand_stream nand_stream_t;
+
+int nand_stream_open(nand_stream_t *s, nand_info_t *nand, ulong start,
+		     ulong end, int quiet);
+int nand_stream_read(nand_stream_t *s, u_char *buf, ulong len);
+void nand_stream_close(nand_stream_t *s);
+
 #define NAND_LOCK_STATUS_TIGHT	0x01
 #define NAND_LOCK_STATUS_LOCK	0x02
 #define NAND_LOCK_STATUS_UNLOCK 0x04
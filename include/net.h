@@ -282,6 +282,13 @@ typedef struct icmphdr {
 #define PKTSIZE_ALIGN		1536
 /*#define PKTSIZE		608*/
 
+/*
+ * Largest IP payload CONFIG_IP_DEFRAG reassembles
+ */
+#ifndef CONFIG_NET_MAXDEFRAG
+#define CONFIG_NET_MAXDEFRAG	16384
+#endif
+
 /*
  * Maximum receive ring size; that is, the number of packets
  * we can buffer before overflow happens. Basically, this just
@@ -315,6 +322,9 @@ extern char		NetOurRootPath[64];	/* Our root path		*/
 extern ushort		NetBootFileSize;	/* Our boot file size in blocks	*/
 /** END OF BOOTP EXTENTIONS **/
 extern ulong		NetBootFileXferSize;	/* size of bootfile in bytes	*/
+#ifdef CONFIG_GUNZIP_STREAM
+extern int		TftpGunzip;		/* inflate bootfile while loading */
+#endif
 extern uchar		NetOurEther[6];		/* Our ethernet address		*/
 extern uchar		NetServerEther[6];	/* Boot server enet address	*/
 extern IPaddr_t		NetOurIP;		/* Our    IP addr (0 = unknown)	*/
@@ -337,6 +347,10 @@ extern ushort		CDPNativeVLAN;		/* CDP returned native VLAN	*/
 extern ushort		CDPApplianceVLAN;	/* CDP returned appliance VLAN	*/
 
 extern int		NetState;		/* Network loop state		*/
+#ifdef CONFIG_IP_DEFRAG
+extern ulong		NetDefragOk;		/* IP datagrams reassembled	*/
+extern ulong		NetDefragDrop;		/* IP fragments dropped		*/
+#endif
 #define NETLOOP_CONTINUE	1
 #define NETLOOP_RESTART		2
 #define NETLOOP_SUCCESS		3
@@ -90,6 +90,18 @@ void sha1_csum( unsigned char *input, int ilen,
 void sha1_csum_wd (unsigned char *input, int ilen,
 		unsigned char output[20], unsigned int chunk_sz);
 
+/**
+ * \brief	   Output = SHA-1( input buffer ), copying the input to dst
+ *
+ * \param dst	   where to copy the data to (may only overlap from below)
+ * \param input    buffer holding the  data
+ * \param ilen	   length of the input data
+ * \param output   SHA-1 checksum result
+ * \param chunk_sz watchdog triggering period (in bytes of input processed)
+ */
+void sha1_csum_copy_wd (unsigned char *dst, unsigned char *input, int ilen,
+		unsigned char output[20], unsigned int chunk_sz);
+
 /**
  * \brief	   Output = SHA-1( file contents )
  *
@@ -0,0 +1,347 @@
+/*
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * Binary BCH encoder/decoder correcting up to t bit errors in a
+ * shortened code over GF(2^m).
+ *
+ * The data is taken as a bit string, MSB of the first byte first, and
+ * the ECC is the remainder of data(x) * x^ecc_bits divided by the
+ * generator polynomial, the LCM of the minimal polynomials of
+ * alpha^1, alpha^3, ... alpha^(2t-1). The encoder divides a byte at a
+ * time through a 256 entry remainder table.
+ *
+ * Decoding: the remainder of the received data is XORed with the
+ * received ECC, which is zero for an error free block. Otherwise the
+ * syndromes are evaluated from its set bits with the log/antilog
+ * tables, Berlekamp-Massey gives the error locator polynomial and a
+ * Chien search over the used part of the code finds its roots.
+ */
+
+#ifndef USE_HOSTCC
+#include <common.h>
+#include <malloc.h>
+#include <linux/string.h>
+#else
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#endif /* USE_HOSTCC */
+#include <bch.h>
+
+#define BCH_MAX_WORDS	((BCH_MAX_M * BCH_MAX_T + 31) / 32)
+
+/* Primitive polynomials for GF(2^5) .. GF(2^13) */
+static const uint16_t bch_prim_poly[] = {
+	0x25, 0x43, 0x83, 0x11d, 0x211, 0x409, 0x805, 0x1053, 0x201b
+};
+
+static inline unsigned int gf_mul (struct bch_control *bch,
+				   unsigned int a, unsigned int b)
+{
+	unsigned int l;
+
+	if (!a || !b)
+		return 0;
+	l = bch->a_log[a] + bch->a_log[b];
+	if (l >= bch->n)
+		l -= bch->n;
+	return bch->a_pow[l];
+}
+
+static inline unsigned int gf_div (struct bch_control *bch,
+				   unsigned int a, unsigned int b)
+{
+	int l;
+
+	if (!a)
+		return 0;
+	l = bch->a_log[a] - bch->a_log[b];
+	if (l < 0)
+		l += bch->n;
+	return bch->a_pow[l];
+}
+
+/*
+ * Build the generator polynomial, left aligned in ecc_words words
+ * without its x^ecc_bits term, and the byte-wise remainder table.
+ */
+static int bch_build_gen (struct bch_control *bch)
+{
+	uint16_t g[BCH_MAX_M * BCH_MAX_T + 1];
+	uint32_t gen[BCH_MAX_WORDS], r[BCH_MAX_WORDS];
+	unsigned char *root;
+	int i, j, k, deg, fb, nw;
+
+	root = malloc (bch->n);
+	if (root == NULL)
+		return -1;
+	memset (root, 0, bch->n);
+
+	/* the roots are the cyclotomic cosets of alpha^1, ^3, ... */
+	for (i = 1; i < 2 * bch->t; i += 2) {
+		j = i;
+		do {
+			root[j] = 1;
+			j = (2 * j) % bch->n;
+		} while (j != i);
+	}
+
+	/* g(x) = product of (x + alpha^j) over the roots */
+	deg = 0;
+	g[0] = 1;
+	for (j = 0; j < bch->n; j++) {
+		if (!root[j])
+			continue;
+		g[++deg] = 0;
+		for (k = deg; k > 0; k--)
+			g[k] = g[k - 1] ^ gf_mul (bch, g[k], bch->a_pow[j]);
+		g[0] = gf_mul (bch, g[0], bch->a_pow[j]);
+	}
+	free (root);
+
+	bch->ecc_bits = deg;
+	bch->ecc_bytes = (deg + 7) / 8;
+	bch->ecc_words = nw = (deg + 31) / 32;
+
+	/* coefficient of x^(deg-1-i) goes to bit i from the left */
+	memset (gen, 0, sizeof (gen));
+	for (i = 0; i < deg; i++)
+		if (g[deg - 1 - i])
+			gen[i / 32] |= 0x80000000 >> (i % 32);
+
+	bch->mod_tab = malloc (256 * nw * sizeof (uint32_t));
+	if (bch->mod_tab == NULL)
+		return -1;
+
+	for (i = 0; i < 256; i++) {
+		memset (r, 0, sizeof (r));
+		for (j = 7; j >= 0; j--) {
+			fb = (r[0] >> 31) ^ ((i >> j) & 1);
+			for (k = 0; k < nw - 1; k++)
+				r[k] = (r[k] << 1) | (r[k + 1] >> 31);
+			r[nw - 1] <<= 1;
+			if (fb)
+				for (k = 0; k < nw; k++)
+					r[k] ^= gen[k];
+		}
+		memcpy (&bch->mod_tab[i * nw], r, nw * sizeof (uint32_t));
+	}
+
+	return 0;
+}
+
+struct bch_control *init_bch (int m, int t)
+{
+	struct bch_control *bch;
+	unsigned int x;
+	int i;
+
+	if (m < 5 || m > BCH_MAX_M || t < 1 || t > BCH_MAX_T)
+		return NULL;
+
+	bch = malloc (sizeof (*bch));
+	if (bch == NULL)
+		return NULL;
+	memset (bch, 0, sizeof (*bch));
+	bch->m = m;
+	bch->n = (1 << m) - 1;
+	bch->t = t;
+
+	bch->a_pow = malloc ((bch->n + 1) * sizeof (uint16_t));
+	bch->a_log = malloc ((bch->n + 1) * sizeof (uint16_t));
+	if (bch->a_pow == NULL || bch->a_log == NULL)
+		goto err;
+
+	x = 1;
+	for (i = 0; i < bch->n; i++) {
+		bch->a_pow[i] = x;
+		bch->a_log[x] = i;
+		x <<= 1;
+		if (x & (1 << m))
+			x ^= bch_prim_poly[m - 5];
+	}
+	bch->a_pow[bch->n] = 1;
+	bch->a_log[0] = 0;
+
+	if (bch_build_gen (bch) || bch->ecc_bits > m * t)
+		goto err;
+
+	return bch;
+
+err:
+	free_bch (bch);
+	return NULL;
+}
+
+void free_bch (struct bch_control *bch)
+{
+	if (bch == NULL)
+		return;
+	free (bch->a_pow);
+	free (bch->a_log);
+	free (bch->mod_tab);
+	free (bch);
+}
+
+/* Remainder of data(x) * x^ecc_bits, left aligned in r */
+static void bch_remainder (struct bch_control *bch, const uint8_t *data,
+			   unsigned int len, uint32_t *r)
+{
+	const uint32_t *p;
+	int nw = bch->ecc_words, k;
+
+	memset (r, 0, nw * sizeof (uint32_t));
+	while (len--) {
+		p = &bch->mod_tab[((r[0] >> 24) ^ *data++) * nw];
+		for (k = 0; k < nw - 1; k++)
+			r[k] = ((r[k] << 8) | (r[k + 1] >> 24)) ^ p[k];
+		r[k] = (r[k] << 8) ^ p[k];
+	}
+}
+
+void encode_bch (struct bch_control *bch, const uint8_t *data,
+		 unsigned int len, uint8_t *ecc)
+{
+	uint32_t r[BCH_MAX_WORDS];
+	int i;
+
+	bch_remainder (bch, data, len, r);
+	for (i = 0; i < bch->ecc_bytes; i++)
+		ecc[i] = r[i / 4] >> (24 - 8 * (i % 4));
+}
+
+/* Berlekamp-Massey: error locator c[] from s[i] = S(i+1), returns degree */
+static int bch_locator (struct bch_control *bch, const uint16_t *s,
+			uint16_t *c)
+{
+	uint16_t b[2 * BCH_MAX_T + 1], tmp[2 * BCH_MAX_T + 1];
+	unsigned int d, bd = 1, coef;
+	int n2t = 2 * bch->t, len = 0, shift = 1, r, i;
+
+	memset (c, 0, (n2t + 1) * sizeof (uint16_t));
+	memset (b, 0, sizeof (b));
+	c[0] = b[0] = 1;
+
+	for (r = 0; r < n2t; r++) {
+		d = s[r];
+		for (i = 1; i <= len; i++)
+			d ^= gf_mul (bch, c[i], s[r - i]);
+		if (!d) {
+			shift++;
+			continue;
+		}
+
+		coef = gf_div (bch, d, bd);
+		memcpy (tmp, c, (n2t + 1) * sizeof (uint16_t));
+		for (i = 0; i + shift <= n2t; i++)
+			c[i + shift] ^= gf_mul (bch, coef, b[i]);
+
+		if (2 * len <= r) {
+			len = r + 1 - len;
+			memcpy (b, tmp, (n2t + 1) * sizeof (uint16_t));
+			bd = d;
+			shift = 1;
+		} else
+			shift++;
+	}
+
+	return len;
+}
+
+int decode_bch (struct bch_control *bch, const uint8_t *data,
+		unsigned int len, const uint8_t *recv_ecc,
+		const uint8_t *calc_ecc, unsigned int *errloc)
+{
+	uint32_t r[BCH_MAX_WORDS];
+	uint16_t s[2 * BCH_MAX_T], c[2 * BCH_MAX_T + 1];
+	int lc[BCH_MAX_T + 1];
+	unsigned int nbits = len * 8 + bch->ecc_bits, x;
+	int deg, i, j, e, l, nerr, any = 0;
+
+	if (nbits > bch->n)
+		return -1;
+
+	if (calc_ecc) {
+		memset (r, 0, sizeof (r));
+		for (i = 0; i < bch->ecc_bytes; i++)
+			r[i / 4] |= (uint32_t)calc_ecc[i] << (24 - 8 * (i % 4));
+	} else
+		bch_remainder (bch, data, len, r);
+	for (i = 0; i < bch->ecc_bytes; i++)
+		r[i / 4] ^= (uint32_t)recv_ecc[i] << (24 - 8 * (i % 4));
+	/* bits past ecc_bits in the last byte do not take part */
+	if (bch->ecc_bits % 32)
+		r[bch->ecc_words - 1] &= ~(0xffffffff >> (bch->ecc_bits % 32));
+	for (i = 0; i < bch->ecc_words; i++)
+		any |= r[i];
+	if (!any)
+		return 0;
+
+	/* odd syndromes from the set bits of the remainder, x^e for bit i */
+	memset (s, 0, sizeof (s));
+	for (i = 0; i < bch->ecc_bits; i++) {
+		if (!(r[i / 32] & (0x80000000 >> (i % 32))))
+			continue;
+		e = bch->ecc_bits - 1 - i;
+		for (j = 1, l = e; j < 2 * bch->t; j += 2) {
+			s[j - 1] ^= bch->a_pow[l];
+			l += 2 * e;
+			while (l >= bch->n)
+				l -= bch->n;
+		}
+	}
+	/* S(2j) = S(j)^2 */
+	for (j = 2; j <= 2 * bch->t; j += 2)
+		s[j - 1] = gf_mul (bch, s[j / 2 - 1], s[j / 2 - 1]);
+
+	deg = bch_locator (bch, s, c);
+	if (deg > bch->t)
+		return -1;
+
+	/* Chien search: error at x^e if c(alpha^-e) == 0 */
+	for (i = 0; i <= deg; i++)
+		lc[i] = c[i] ? bch->a_log[c[i]] : -1;
+
+	nerr = 0;
+	for (e = 0; e < nbits && nerr < deg; e++) {
+		x = c[0];
+		for (i = 1; i <= deg; i++) {
+			if (lc[i] < 0)
+				continue;
+			x ^= bch->a_pow[lc[i]];
+			lc[i] -= i;
+			if (lc[i] < 0)
+				lc[i] += bch->n;
+		}
+		if (x)
+			continue;
+
+		if (e < bch->ecc_bits) {
+			j = bch->ecc_bits - 1 - e;
+			errloc[nerr++] = len * 8 + (j & ~7) + 7 - (j & 7);
+		} else {
+			j = len * 8 - 1 - (e - bch->ecc_bits);
+			errloc[nerr++] = (j & ~7) + 7 - (j & 7);
+		}
+	}
+
+	return nerr == deg ? nerr : -1;
+}
@@ -347,6 +347,39 @@ void sha1_csum_wd (unsigned char *input, int ilen, unsigned char output[20],
 	sha1_finish (&ctx, output);
 }
 
+/*
+ * Output = SHA-1( input buffer ), copying the input to 'dst' on the way.
+ * The source is read only once; each block is hashed from the fresh
+ * copy.  The areas may only overlap if 'dst' is below 'input'.  Trigger
+ * the watchdog every 'chunk_sz' bytes at most.
+ */
+#define COPY_BLKSZ	4096
+
+void sha1_csum_copy_wd (unsigned char *dst, unsigned char *input, int ilen,
+			unsigned char output[20], unsigned int chunk_sz)
+{
+	sha1_context ctx;
+	int chunk;
+
+	sha1_starts (&ctx);
+
+	while (ilen > 0) {
+		chunk = ((unsigned int)ilen < chunk_sz) ? ilen : chunk_sz;
+		if (chunk > COPY_BLKSZ)
+			chunk = COPY_BLKSZ;
+		memmove (dst, input, chunk);
+		sha1_update (&ctx, dst, chunk);
+		dst += chunk;
+		input += chunk;
+		ilen -= chunk;
+#if defined(CONFIG_HW_WATCHDOG) || defined(CONFIG_WATCHDOG)
+		WATCHDOG_RESET ();
+#endif
+	}
+
+	sha1_finish (&ctx, output);
+}
+
 /*
  * Output = HMAC-SHA-1( input buffer, hmac key )
  */
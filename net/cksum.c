@@ -0,0 +1,72 @@
+/*
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+#ifndef USE_HOSTCC
+#include <common.h>
+#include <net.h>
+#else
+#include <stdint.h>
+typedef unsigned char uchar;
+typedef uint16_t __u16;
+typedef uint32_t __u32;
+#endif /* USE_HOSTCC */
+
+#ifndef __HAVE_ARCH_NETCKSUM
+/*
+ * One's complement sum of len halfwords.  Adding 32 bit words into a
+ * 64 bit accumulator and folding at the end gives the same result as
+ * adding halfwords, with half the loads and no carry handling in the
+ * loop.  Architectures may provide an assembler version instead;
+ * tools/cksum_test checks this one against the plain halfword loop.
+ */
+unsigned
+NetCksum(uchar * ptr, int len)
+{
+	unsigned long long xsum = 0;
+	__u16 *p = (__u16 *)ptr;
+	__u32 *w;
+
+	if (len > 0 && ((unsigned long)p & 2)) {	/* word align */
+		xsum += *p++;
+		len--;
+	}
+	w = (__u32 *)p;
+	while (len >= 8) {
+		xsum += w[0];
+		xsum += w[1];
+		xsum += w[2];
+		xsum += w[3];
+		w += 4;
+		len -= 8;
+	}
+	while (len >= 2) {
+		xsum += *w++;
+		len -= 2;
+	}
+	if (len > 0)
+		xsum += *(__u16 *)w;
+
+	xsum = (xsum & 0xffffffff) + (xsum >> 32);
+	xsum = (xsum & 0xffffffff) + (xsum >> 32);
+	xsum = (xsum & 0xffff) + (xsum >> 16);
+	xsum = (xsum & 0xffff) + (xsum >> 16);
+	return (xsum & 0xffff);
+}
+#endif /* __HAVE_ARCH_NETCKSUM */
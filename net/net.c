@@ -200,6 +200,97 @@ volatile uchar *NetTxPacket = 0;	/* THE transmit packet			*/
 
 static int net_check_prereq (proto_t protocol);
 
+#ifdef CONFIG_IP_DEFRAG
+/*
+ * IP fragment reassembly.  Only a single UDP datagram, keyed by source
+ * address and IP id, is reassembled at a time - enough for TFTP with a
+ * block size above the MTU.  A fragment of another datagram, or one
+ * arriving after IP_DEFRAG_TIMEOUT, abandons the datagram in progress.
+ */
+#if CONFIG_NET_MAXDEFRAG > (65535 - 20)
+#error "CONFIG_NET_MAXDEFRAG is larger than the maximum IP payload"
+#endif
+
+#define IP_OFFS			0x1fff	/* fragment offset, 8 byte units */
+#define IP_FLAGS_MFRAG		0x2000	/* more fragments follow	*/
+#define IP_DEFRAG_UNITS		((CONFIG_NET_MAXDEFRAG + 7) / 8)
+#define IP_DEFRAG_TIMEOUT	(2 * CFG_HZ)
+
+static uchar	DefragBuf[20 + CONFIG_NET_MAXDEFRAG] __attribute__ ((aligned(4)));
+static ulong	DefragMap[(IP_DEFRAG_UNITS + 31) / 32];	/* units received */
+static int	DefragActive;		/* DefragBuf holds a partial datagram	*/
+static IPaddr_t	DefragSrc;		/* source address of that datagram	*/
+static ushort	DefragId;		/* IP id of that datagram		*/
+static unsigned	DefragUnits;		/* 8 byte units received so far		*/
+static unsigned	DefragLen;		/* payload length, 0 until last frag	*/
+static ulong	DefragStart;		/* time the first fragment arrived	*/
+ulong		NetDefragOk;		/* datagrams reassembled		*/
+ulong		NetDefragDrop;		/* fragments/datagrams dropped		*/
+
+/*
+ * Add a fragment; return the reassembled datagram once it is complete,
+ * updating *lenp, or NULL while fragments are still missing.
+ */
+static IP_t *NetDefragment (IP_t *ip, int *lenp)
+{
+	IPaddr_t src = NetReadIP(&ip->ip_src);
+	unsigned off = (ntohs(ip->ip_off) & IP_OFFS) * 8;
+	unsigned len = *lenp - IP_HDR_SIZE_NO_UDP;
+	int last = (ntohs(ip->ip_off) & IP_FLAGS_MFRAG) == 0;
+	unsigned i;
+
+	if (DefragActive &&
+	    (src != DefragSrc || ip->ip_id != DefragId ||
+	     get_timer(DefragStart) > IP_DEFRAG_TIMEOUT)) {
+		DefragActive = 0;
+		NetDefragDrop++;
+	}
+
+	/* all but the last fragment carry a multiple of 8 bytes */
+	if (ip->ip_p != IPPROTO_UDP || off + len > CONFIG_NET_MAXDEFRAG ||
+	    (!last && (len & 7) != 0)) {
+		NetDefragDrop++;
+		return NULL;
+	}
+
+	if (!DefragActive) {
+		memset (DefragMap, 0, sizeof(DefragMap));
+		DefragActive = 1;
+		DefragSrc = src;
+		DefragId = ip->ip_id;
+		DefragUnits = 0;
+		DefragLen = 0;
+		DefragStart = get_timer(0);
+	}
+
+	if (off == 0)
+		memcpy (DefragBuf, ip, IP_HDR_SIZE_NO_UDP);
+	memcpy (DefragBuf + IP_HDR_SIZE_NO_UDP + off,
+		(uchar *)ip + IP_HDR_SIZE_NO_UDP, len);
+	if (last)
+		DefragLen = off + len;
+
+	for (i = off / 8; i < (off + len + 7) / 8; i++) {
+		if ((DefragMap[i / 32] & (1UL << (i % 32))) == 0) {
+			DefragMap[i / 32] |= 1UL << (i % 32);
+			DefragUnits++;
+		}
+	}
+
+	if (DefragLen == 0 || DefragUnits != (DefragLen + 7) / 8)
+		return NULL;
+
+	DefragActive = 0;
+	NetDefragOk++;
+
+	ip = (IP_t *)DefragBuf;
+	*lenp = IP_HDR_SIZE_NO_UDP + DefragLen;
+	ip->ip_len = htons(*lenp);
+	ip->ip_off = 0;
+	return ip;
+}
+#endif /* CONFIG_IP_DEFRAG */
+
 /**********************************************************************/
 
 IPaddr_t	NetArpWaitPacketIP;
@@ -473,6 +564,9 @@ restart:
 		}
 
 		NetBootFileXferSize = 0;
+#ifdef CONFIG_IP_DEFRAG
+		NetDefragOk = NetDefragDrop = 0;
+#endif
 		break;
 	}
 
@@ -565,6 +659,12 @@ restart:
 				sprintf(buf, "%lX", (unsigned long)load_addr);
 				setenv("fileaddr", buf);
 			}
+#ifdef CONFIG_IP_DEFRAG
+			if (NetDefragOk || NetDefragDrop)
+				printf("IP fragments: %ld datagrams reassembled, "
+					"%ld dropped\n",
+					NetDefragOk, NetDefragDrop);
+#endif
 			eth_halt();
 			return NetBootFileXferSize;
 
@@ -1404,9 +1504,6 @@ NetReceive(volatile uchar * inpkt, int len)
 		if ((ip->ip_hl_v & 0xf0) != 0x40) {
 			return;
 		}
-		if (ip->ip_off & htons(0x1fff)) { /* Can't deal w/ fragments */
-			return;
-		}
 		/* can't deal with headers > 20 bytes */
 		if ((ip->ip_hl_v & 0x0f) > 0x05) {
 			return;
@@ -1422,6 +1519,18 @@ NetReceive(volatile uchar * inpkt, int len)
 #endif
 			return;
 		}
+#ifdef CONFIG_IP_DEFRAG
+		/* only fragments meant for us may disturb the reassembly */
+		if (ip->ip_off & htons(IP_OFFS | IP_FLAGS_MFRAG)) {
+			ip = NetDefragment(ip, &len);
+			if (ip == NULL)
+				return;
+		}
+#else
+		if (ip->ip_off & htons(0x1fff)) { /* Can't deal w/ fragments */
+			return;
+		}
+#endif
 		/*
 		 * watch for ICMP host redirects
 		 *
@@ -1485,37 +1594,35 @@ NetReceive(volatile uchar * inpkt, int len)
 		} else if (ip->ip_p != IPPROTO_UDP) {	/* Only UDP packets */
 			return;
 		}
+		/* the UDP length must fit the (reassembled) datagram */
+		if (ntohs(ip->udp_len) < 8 ||
+		    ntohs(ip->udp_len) > len - IP_HDR_SIZE_NO_UDP) {
+			debug ("udp_len bad %d > %d\n", ntohs(ip->udp_len),
+			       len - IP_HDR_SIZE_NO_UDP);
+			return;
+		}
 
 #ifdef CONFIG_UDP_CHECKSUM
 		if (ip->udp_xsum != 0) {
-			ulong   xsum;
-			ushort *sumptr;
-			ushort  sumlen;
-
-			xsum  = ip->ip_p;
-			xsum += (ntohs(ip->udp_len));
-			xsum += (ntohl(ip->ip_src) >> 16) & 0x0000ffff;
-			xsum += (ntohl(ip->ip_src) >>  0) & 0x0000ffff;
-			xsum += (ntohl(ip->ip_dst) >> 16) & 0x0000ffff;
-			xsum += (ntohl(ip->ip_dst) >>  0) & 0x0000ffff;
+			ulong	xsum;
+			ushort	sumlen;
+			ushort	last = 0;
 
+			/*
+			 * Sum in network byte order, which one's complement
+			 * arithmetic does not care about: pseudo header
+			 * (addresses, protocol, length), then the UDP header
+			 * and payload; an odd last byte is padded with zero.
+			 */
 			sumlen = ntohs(ip->udp_len);
-			sumptr = (ushort *) &(ip->udp_src);
-
-			while (sumlen > 1) {
-				ushort sumdata;
-
-				sumdata = *sumptr++;
-				xsum += ntohs(sumdata);
-				sumlen -= 2;
-			}
-			if (sumlen > 0) {
-				ushort sumdata;
-
-				sumdata = *(unsigned char *) sumptr;
-				sumdata = (sumdata << 8) & 0xff00;
-				xsum += sumdata;
-			}
+			if (sumlen & 1)
+				*(uchar *)&last = *((uchar *)&ip->udp_src + sumlen - 1);
+
+			xsum  = NetCksum((uchar *)&ip->ip_src, 4);
+			xsum += NetCksum((uchar *)&ip->udp_src, sumlen / 2);
+			xsum += htons(ip->ip_p);
+			xsum += ip->udp_len;
+			xsum += last;
 			while ((xsum >> 16) != 0) {
 				xsum = (xsum & 0x0000ffff) + ((xsum >> 16) & 0x0000ffff);
 			}
@@ -1631,20 +1738,6 @@ NetCksumOk(uchar * ptr, int len)
 }
 
 
-unsigned
-NetCksum(uchar * ptr, int len)
-{
-	ulong	xsum;
-	ushort *p = (ushort *)ptr;
-
-	xsum = 0;
-	while (len-- > 0)
-		xsum += *p++;
-	xsum = (xsum & 0xffff) + (xsum >> 16);
-	xsum = (xsum & 0xffff) + (xsum >> 16);
-	return (xsum & 0xffff);
-}
-
 int
 NetEthHdrSize(void)
 {
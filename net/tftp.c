@@ -64,17 +64,43 @@ static char default_filename[DEFAULT_NAME_LEN];
 
 static char tftp_filename[MAX_LEN];
 
-#ifdef CFG_DIRECT_FLASH_TFTP
-extern flash_info_t flash_info[];
-#endif
 
 /* 512 is poor choice for ethernet, MTU is typically 1500.
  * Minus eth.hdrs thats 1468.  Can get 2x better throughput with
  * almost-MTU block sizes.  At least try... fall back to 512 if need be.
  */
 #define TFTP_MTU_BLOCKSIZE 1468
+/* with IP fragment reassembly, larger blocks mean far fewer ACKs */
+#ifndef CONFIG_TFTP_BLOCKSIZE
+#define CONFIG_TFTP_BLOCKSIZE	TFTP_MTU_BLOCKSIZE
+#endif
+/* the most a datagram can carry (UDP and TFTP headers: 12 bytes), and
+ * the RFC 2348 limit
+ */
+#ifdef CONFIG_IP_DEFRAG
+#if CONFIG_NET_MAXDEFRAG - 12 < 65464
+#define TFTP_MAX_BLOCKSIZE	(CONFIG_NET_MAXDEFRAG - 12)
+#else
+#define TFTP_MAX_BLOCKSIZE	65464
+#endif
+#else
+#define TFTP_MAX_BLOCKSIZE	TFTP_MTU_BLOCKSIZE
+#endif
 static unsigned short TftpBlkSize=TFTP_BLOCK_SIZE;
-static unsigned short TftpBlkSizeOption=TFTP_MTU_BLOCKSIZE;
+static unsigned short TftpBlkSizeOption=CONFIG_TFTP_BLOCKSIZE;
+
+/* RFC 7440 "windowsize": the server sends up to TftpWindowSize blocks
+ * before waiting for an ACK, so the transfer is no longer bound by the
+ * round trip time.  A window of 1 is plain lock-step RFC 1350.
+ */
+#ifndef CONFIG_TFTP_WINDOWSIZE
+#define CONFIG_TFTP_WINDOWSIZE	1
+#endif
+#define TFTP_MAX_WINDOWSIZE	64
+static unsigned short TftpWindowSize=1;
+static unsigned short TftpWindowSizeOption=CONFIG_TFTP_WINDOWSIZE;
+static unsigned short TftpWindowCount;	/* blocks received since last ACK */
+static int	TftpWindowGap;		/* ACK for last good block already sent */
 
 #ifdef CONFIG_MCAST_TFTP
 #include <malloc.h>
@@ -101,24 +127,237 @@ mcast_cleanup(void)
 
 #endif	/* CONFIG_MCAST_TFTP */
 
+#ifdef CONFIG_GUNZIP_STREAM
+#ifndef CFG_BOOTM_LEN
+#define CFG_BOOTM_LEN	0x800000	/* use 8MByte as default max gunzip size */
+#endif
+int TftpGunzip;				/* inflate gzip data while loading */
+#endif
+
+#ifdef CFG_DIRECT_FLASH_TFTP
+/*
+ * Pipelined flash sink: received data is queued in a RAM ring and
+ * programmed in write buffer sized chunks, while the sectors ahead of
+ * the write pointer are erased in the background.  Erase, program and
+ * the network transfer thus overlap instead of adding up.
+ *
+ * The sector holding an unaligned load address is not erased; as
+ * before, that part of the flash must have been erased beforehand.
+ */
+#ifndef CFG_TFTP_FLASH_RING_SIZE
+#define CFG_TFTP_FLASH_RING_SIZE	0x10000
+#endif
+#ifndef CFG_TFTP_FLASH_CHUNK
+#define CFG_TFTP_FLASH_CHUNK		64	/* power of 2 */
+#endif
+#ifdef CFG_TFTP_FLASH_RING_ADDR
+#define FlashRing	((uchar *)CFG_TFTP_FLASH_RING_ADDR)
+#else
+static uchar FlashRing[CFG_TFTP_FLASH_RING_SIZE];
+#endif
+#define FLASH_PUMP_ALL	(~0UL)		/* program everything, wait for erase */
+
+static flash_info_t *FlashSink;		/* load_addr is in this bank, or NULL */
+static ulong	FlashRecv;		/* bytes queued into the ring		*/
+static ulong	FlashProg;		/* bytes programmed so far		*/
+static ulong	FlashErased;		/* flash is erased up to this address	*/
+static ulong	FlashEraseEnd;		/* end of the sector being erased	*/
+static flash_info_t *FlashEraseInfo;
+static int	FlashEraseSect;		/* sector being erased, or -1		*/
+static ulong	TftpTsize;		/* file size from "tsize" option, or 0	*/
+
+#ifndef CFG_FLASH_ASYNC_ERASE
+/* board driver can't erase in the background; do it synchronously */
+static int flash_erase_start (flash_info_t *info, int sect)
+{
+	return flash_erase (info, sect, sect) ? ERR_PROG_ERROR : ERR_OK;
+}
+
+static int flash_erase_poll (flash_info_t *info, int sect)
+{
+	return ERR_OK;
+}
+#endif
+
+/* start erasing the sector at FlashErased */
+static int
+tftp_flash_erase_next (void)
+{
+	flash_info_t *info = addr2info (FlashErased);
+	int sect, rc;
+
+	if (info == NULL)
+		return ERR_INVAL;
+	for (sect = 0; sect < info->sector_count; sect++)
+		if (info->start[sect] == FlashErased)
+			break;
+	if (sect == info->sector_count)
+		return ERR_ALIGN;
+
+	rc = flash_erase_start (info, sect);
+	if (rc != ERR_OK)
+		return rc;
+
+	FlashEraseInfo = info;
+	FlashEraseSect = sect;
+	FlashEraseEnd = (sect == info->sector_count - 1) ?
+		info->start[0] + info->size : info->start[sect + 1];
+	return ERR_OK;
+}
+
+/*
+ * Move received data towards the flash: finish the erase in flight,
+ * program what has been both received and erased, and erase ahead.
+ * Waits until at least "want" bytes have been programmed; with want
+ * of 0 only does what can be done without waiting.
+ */
+static int
+tftp_flash_pump (ulong want)
+{
+	ulong n, end, pos;
+	int rc, step;
+
+#ifdef CONFIG_MCAST_TFTP
+	if (Multicast)
+		return ERR_OK;
+#endif
+	for (;;) {
+		if (FlashEraseSect >= 0) {
+			rc = flash_erase_poll (FlashEraseInfo, FlashEraseSect);
+			if (rc == 1) {			/* still busy */
+				if (FlashProg >= want)
+					return ERR_OK;
+				continue;
+			}
+			FlashEraseSect = -1;
+			if (rc != ERR_OK)
+				return rc;
+			FlashErased = FlashEraseEnd;
+		}
+
+		/* program what is both received and erased */
+		end = FlashErased - load_addr;
+		if (end > FlashRecv)
+			end = FlashRecv;
+		if (FlashProg < want) {
+			if (end > want)
+				end = want;
+		} else {
+			/* keep the network going: whole chunks, a bit at a time */
+			if (end > FlashProg + 2 * TftpBlkSize)
+				end = FlashProg + 2 * TftpBlkSize;
+			end = ((load_addr + end) & ~(CFG_TFTP_FLASH_CHUNK - 1))
+				- load_addr;
+		}
+		if (end > FlashProg) {
+			pos = FlashProg % CFG_TFTP_FLASH_RING_SIZE;
+			n = end - FlashProg;
+			if (n > CFG_TFTP_FLASH_RING_SIZE - pos)
+				n = CFG_TFTP_FLASH_RING_SIZE - pos;
+			step = FlashProg >= want;	/* one step only */
+			rc = flash_write ((char *)FlashRing + pos,
+					  load_addr + FlashProg, n);
+			if (rc != ERR_OK)
+				return rc;
+			FlashProg += n;
+			if (step)
+				return ERR_OK;
+			continue;
+		}
+
+		/* erase ahead: the whole file if its size is known */
+		end = (TftpTsize > FlashRecv) ? TftpTsize : FlashRecv;
+		if (FlashErased - load_addr < end) {
+			rc = tftp_flash_erase_next ();
+			if (rc != ERR_OK)
+				return rc;
+			continue;
+		}
+		return ERR_OK;
+	}
+}
+
+/* queue in-order data for the flash, making room in the ring as needed */
+static int
+tftp_flash_store (ulong offset, uchar *src, unsigned len)
+{
+	ulong n, pos;
+	int rc;
+
+#ifdef CONFIG_MCAST_TFTP
+	/* blocks may arrive in any order; program them in place */
+	if (Multicast)
+		return flash_write ((char *)src, load_addr + offset, len);
+#endif
+	if (offset != FlashRecv)
+		return ERR_INVAL;
+
+	while (len) {
+		n = CFG_TFTP_FLASH_RING_SIZE - (FlashRecv - FlashProg);
+		if (n == 0) {
+			rc = tftp_flash_pump (FlashRecv + len -
+					      CFG_TFTP_FLASH_RING_SIZE);
+			if (rc != ERR_OK)
+				return rc;
+			continue;
+		}
+		pos = FlashRecv % CFG_TFTP_FLASH_RING_SIZE;
+		if (n > CFG_TFTP_FLASH_RING_SIZE - pos)
+			n = CFG_TFTP_FLASH_RING_SIZE - pos;
+		if (n > len)
+			n = len;
+		memcpy (FlashRing + pos, src, n);
+		FlashRecv += n;
+		src += n;
+		len -= n;
+	}
+	return ERR_OK;
+}
+
+static void
+tftp_flash_init (void)
+{
+	int sect;
+
+	/* don't leave an erase from an aborted transfer running */
+	while (FlashEraseSect >= 0 &&
+	       flash_erase_poll (FlashEraseInfo, FlashEraseSect) == 1)
+		;
+	FlashEraseSect = -1;
+	FlashRecv = FlashProg = 0;
+	TftpTsize = 0;
+
+	FlashSink = addr2info (load_addr);
+#ifdef CONFIG_GUNZIP_STREAM
+	if (TftpGunzip)
+		FlashSink = NULL;
+#endif
+	if (FlashSink == NULL)
+		return;
+
+	/* first sector boundary at or above load_addr */
+	FlashErased = FlashSink->start[0] + FlashSink->size;
+	for (sect = 0; sect < FlashSink->sector_count; sect++) {
+		if (FlashSink->start[sect] >= load_addr) {
+			FlashErased = FlashSink->start[sect];
+			break;
+		}
+	}
+}
+#endif /* CFG_DIRECT_FLASH_TFTP */
+
 static __inline__ void
 store_block (unsigned block, uchar * src, unsigned len)
 {
 	ulong offset = block * TftpBlkSize + TftpBlockWrapOffset;
 	ulong newsize = offset + len;
 #ifdef CFG_DIRECT_FLASH_TFTP
-	int i, rc = 0;
-
-	for (i=0; i<CFG_MAX_FLASH_BANKS; i++) {
-		/* start address in flash? */
-		if (load_addr + offset >= flash_info[i].start[0]) {
-			rc = 1;
-			break;
-		}
-	}
+	int rc;
+#endif
 
-	if (rc) { /* Flash is destination for this packet */
-		rc = flash_write ((char *)src, (ulong)(load_addr+offset), len);
+#ifdef CFG_DIRECT_FLASH_TFTP
+	if (FlashSink) { /* Flash is destination for this packet */
+		rc = tftp_flash_store (offset, src, len);
 		if (rc) {
 			flash_perror (rc);
 			NetState = NETLOOP_FAIL;
@@ -186,6 +425,11 @@ TftpSend (void)
 		/* try for more effic. blk size */
 		pkt += sprintf((char *)pkt,"blksize%c%d%c",
 				0,TftpBlkSizeOption,0);
+#ifdef CFG_DIRECT_FLASH_TFTP
+		/* knowing the size lets us erase ahead of the data */
+		if (FlashSink)
+			pkt += sprintf((char *)pkt,"tsize%c0%c",0,0);
+#endif
 #ifdef CONFIG_MCAST_TFTP
 		/* Check all preconditions before even trying the option */
 		if (!ProhibitMcast
@@ -194,8 +438,12 @@ TftpSend (void)
 			free(Bitmap);
 			Bitmap=NULL;
 			pkt += sprintf((char *)pkt,"multicast%c%c",0,0);
-		}
+		} else
 #endif /* CONFIG_MCAST_TFTP */
+		/* multicast clients ACK from a bitmap, never windowed */
+		if (TftpWindowSizeOption > 1)
+			pkt += sprintf((char *)pkt,"windowsize%c%d%c",
+					0,TftpWindowSizeOption,0);
 		len = pkt - xp;
 		break;
 
@@ -299,6 +547,34 @@ TftpHandler (uchar * pkt, unsigned dest, unsigned src, unsigned len)
 				break;
 			}
 		}
+		/* Check for 'windowsize' option */
+		for (i=0; i+11<len; i++) {
+			if (strcmp ((char*)pkt+i,"windowsize") == 0) {
+				ulong ws = simple_strtoul((char*)pkt+i+11,
+							  NULL,10);
+
+				/* the server may only lower what we asked for */
+				if (ws > TftpWindowSizeOption)
+					ws = TftpWindowSizeOption;
+				if (ws < 1)
+					ws = 1;
+				TftpWindowSize = (unsigned short)ws;
+#ifdef ET_DEBUG
+				printf ("Windowsize ack: %s, %d\n",
+					(char*)pkt+i+11,TftpWindowSize);
+#endif
+				break;
+			}
+		}
+#ifdef CFG_DIRECT_FLASH_TFTP
+		/* Check for 'tsize' option */
+		for (i=0; i+6<len; i++) {
+			if (strcmp ((char*)pkt+i,"tsize") == 0) {
+				TftpTsize = simple_strtoul((char*)pkt+i+6,NULL,10);
+				break;
+			}
+		}
+#endif
 #ifdef CONFIG_MCAST_TFTP
 		parse_multicast_oack((char *)pkt,len-1);
 		if ((Multicast) && (!MasterClient))
@@ -313,6 +589,24 @@ TftpHandler (uchar * pkt, unsigned dest, unsigned src, unsigned len)
 		len -= 2;
 		TftpBlock = ntohs(*(ushort *)pkt);
 
+		/*
+		 * In windowed mode anything but the next block in sequence
+		 * means a block was lost (or the server is repeating a
+		 * window whose ACK got lost).  ACK the last contiguous block
+		 * once so the server restarts the window from there, and
+		 * drop everything until the expected block shows up.
+		 */
+		if (TftpState == STATE_DATA && TftpWindowSize > 1 &&
+		    TftpBlock != (TftpLastBlock + 1) % TFTP_SEQUENCE_SIZE) {
+			TftpBlock = TftpLastBlock;
+			if (!TftpWindowGap) {
+				TftpWindowGap = 1;
+				TftpWindowCount = 0;
+				TftpSend ();
+			}
+			break;
+		}
+
 		/*
 		 * RFC1350 specifies that the first data packet will
 		 * have sequence number 1. If we receive a sequence
@@ -368,8 +662,13 @@ TftpHandler (uchar * pkt, unsigned dest, unsigned src, unsigned len)
 		}
 
 		TftpLastBlock = TftpBlock;
+		TftpWindowGap = 0;
 		NetSetTimeout (TIMEOUT * CFG_HZ, TftpTimeout);
 
+#ifdef CONFIG_GUNZIP_STREAM
+		/* inflated once the ACK is out, see below */
+		if (!TftpGunzip)
+#endif
 		store_block (TftpBlock - 1, pkt + 2, len);
 
 		/*
@@ -401,7 +700,33 @@ TftpHandler (uchar * pkt, unsigned dest, unsigned src, unsigned len)
 			}
 		}
 #endif
-		TftpSend ();
+		/*
+		 * With a window, only every Nth block (and the final,
+		 * short one) is acknowledged.
+		 */
+		if (++TftpWindowCount >= TftpWindowSize || len < TftpBlkSize) {
+			TftpWindowCount = 0;
+			TftpSend ();
+		}
+#ifdef CFG_DIRECT_FLASH_TFTP
+		/* ACK is out; use the time until the next block */
+		if (FlashSink && len == TftpBlkSize &&
+		    (i = tftp_flash_pump (0)) != ERR_OK) {
+			flash_perror (i);
+			NetState = NETLOOP_FAIL;
+			break;
+		}
+#endif
+#ifdef CONFIG_GUNZIP_STREAM
+		/*
+		 * Likewise inflate only now: blocks arrive in order and
+		 * the server sends the next one while we are busy here.
+		 */
+		if (TftpGunzip && gunzip_stream_feed (pkt + 2, len) != 0) {
+			NetState = NETLOOP_FAIL;
+			break;
+		}
+#endif
 
 #ifdef CONFIG_MCAST_TFTP
 		if (Multicast) {
@@ -420,6 +745,19 @@ TftpHandler (uchar * pkt, unsigned dest, unsigned src, unsigned len)
 			 */
 			puts ("\ndone\n");
 			NetState = NETLOOP_SUCCESS;
+#ifdef CFG_DIRECT_FLASH_TFTP
+			if (FlashSink &&
+			    (i = tftp_flash_pump (FLASH_PUMP_ALL)) != ERR_OK) {
+				flash_perror (i);
+				NetState = NETLOOP_FAIL;
+			}
+#endif
+#ifdef CONFIG_GUNZIP_STREAM
+			/* check CRC32/ISIZE, report the inflated size */
+			if (TftpGunzip &&
+			    gunzip_stream_end (&NetBootFileXferSize) != 0)
+				NetState = NETLOOP_FAIL;
+#endif
 		}
 		break;
 
@@ -448,6 +786,9 @@ TftpTimeout (void)
 	} else {
 		puts ("T ");
 		NetSetTimeout (TIMEOUT * CFG_HZ, TftpTimeout);
+		/* restart the window from the last block we have */
+		TftpWindowCount = 0;
+		TftpWindowGap = 0;
 		TftpSend ();
 	}
 }
@@ -456,9 +797,7 @@ TftpTimeout (void)
 void
 TftpStart (void)
 {
-#ifdef CONFIG_TFTP_PORT
 	char *ep;             /* Environment pointer */
-#endif
 
 	TftpServerIP = NetServerIP;
 	if (BootFile[0] == '\0') {
@@ -515,6 +854,18 @@ TftpStart (void)
 	putc ('\n');
 
 	printf ("Load address: 0x%lx\n", load_addr);
+#ifdef CFG_DIRECT_FLASH_TFTP
+	tftp_flash_init ();
+#endif
+#ifdef CONFIG_GUNZIP_STREAM
+	if (TftpGunzip) {
+		puts ("Uncompressing while loading\n");
+		if (gunzip_stream_start ((void *)load_addr, CFG_BOOTM_LEN) != 0) {
+			NetState = NETLOOP_FAIL;
+			return;
+		}
+	}
+#endif
 
 	puts ("Loading: *\b");
 
@@ -541,6 +892,29 @@ TftpStart (void)
 	memset(NetServerEther, 0, 6);
 	/* Revert TftpBlkSize to dflt */
 	TftpBlkSize = TFTP_BLOCK_SIZE;
+	TftpBlkSizeOption = CONFIG_TFTP_BLOCKSIZE;
+	if ((ep = getenv("tftpblocksize")) != NULL) {
+		ulong blksize = simple_strtoul(ep, NULL, 10);
+
+		if (blksize < 8)
+			blksize = TFTP_BLOCK_SIZE;
+		if (blksize > TFTP_MAX_BLOCKSIZE)
+			blksize = TFTP_MAX_BLOCKSIZE;
+		TftpBlkSizeOption = blksize;
+	}
+
+	/* No window until the server agrees to one in its OACK */
+	TftpWindowSize = 1;
+	TftpWindowCount = 0;
+	TftpWindowGap = 0;
+	TftpWindowSizeOption = CONFIG_TFTP_WINDOWSIZE;
+	if ((ep = getenv("tftpwindow")) != NULL) {
+		TftpWindowSizeOption = simple_strtoul(ep, NULL, 10);
+		if (TftpWindowSizeOption < 1)
+			TftpWindowSizeOption = 1;
+		if (TftpWindowSizeOption > TFTP_MAX_WINDOWSIZE)
+			TftpWindowSizeOption = TFTP_MAX_WINDOWSIZE;
+	}
 #ifdef CONFIG_MCAST_TFTP
 	mcast_cleanup();
 #endif
@@ -0,0 +1,135 @@
+/*
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * Exercise the BCH codec of lib_generic/bch.c the way NAND_ECC_SOFT_BCH
+ * uses it (GF(2^13), 512 byte blocks): flip random bits in data and
+ * ECC, check that up to t errors are always corrected, count how
+ * often more errors are detected or miscorrected, and report the
+ * encoder throughput.
+ *
+ * usage: bch_test [t [rounds]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/time.h>
+#include <bch.h>
+
+#define BLOCK	512
+
+static void flip (uint8_t *data, uint8_t *ecc, unsigned int bit)
+{
+	if (bit < BLOCK * 8)
+		data[bit / 8] ^= 1 << (bit % 8);
+	else
+		ecc[bit / 8 - BLOCK] ^= 1 << (bit % 8);
+}
+
+/* Inject nerr distinct bit errors, decode, correct, compare */
+static int run (struct bch_control *bch, const uint8_t *ref, int nerr)
+{
+	uint8_t data[BLOCK], ecc[(BCH_MAX_M * BCH_MAX_T + 7) / 8];
+	uint8_t ref_ecc[sizeof (ecc)];
+	unsigned int pos[2 * BCH_MAX_T], errloc[BCH_MAX_T];
+	unsigned int nbits = BLOCK * 8 + bch->ecc_bits;
+	int i, j, n;
+
+	memcpy (data, ref, BLOCK);
+	encode_bch (bch, data, BLOCK, ecc);
+	memcpy (ref_ecc, ecc, bch->ecc_bytes);
+
+	for (i = 0; i < nerr; i++) {
+		do {
+			pos[i] = rand () % nbits;
+			for (j = 0; j < i && pos[j] != pos[i]; j++)
+				;
+		} while (j < i);
+		/* ECC bits are numbered MSB first within ecc_bits */
+		if (pos[i] >= BLOCK * 8) {
+			j = pos[i] - BLOCK * 8;
+			pos[i] = BLOCK * 8 + (j & ~7) + 7 - (j & 7);
+		}
+		flip (data, ecc, pos[i]);
+	}
+
+	n = decode_bch (bch, data, BLOCK, ecc, NULL, errloc);
+	if (n < 0)
+		return -1;
+	for (i = 0; i < n; i++)
+		flip (data, ecc, errloc[i]);
+
+	return memcmp (data, ref, BLOCK) || memcmp (ecc, ref_ecc, bch->ecc_bytes);
+}
+
+int main (int argc, char *argv[])
+{
+	struct bch_control *bch;
+	uint8_t ref[BLOCK], ecc[(BCH_MAX_M * BCH_MAX_T + 7) / 8];
+	struct timeval t0, t1;
+	int t = 4, rounds = 2000, nerr, r, i;
+	int fail = 0, detected, miscorrected;
+	double us;
+
+	if (argc > 1)
+		t = strtol (argv[1], NULL, 0);
+	if (argc > 2)
+		rounds = strtol (argv[2], NULL, 0);
+	if (rounds <= 0 || (bch = init_bch (13, t)) == NULL) {
+		fprintf (stderr, "usage: %s [t (1..%d) [rounds]]\n",
+			 argv[0], BCH_MAX_T);
+		return 1;
+	}
+	printf ("BCH m=13 t=%d: %d ECC bits, %d bytes per %d bytes\n",
+		t, bch->ecc_bits, bch->ecc_bytes, BLOCK);
+
+	srand (1);
+	for (nerr = 0; nerr <= t + 2; nerr++) {
+		detected = miscorrected = 0;
+		for (r = 0; r < rounds; r++) {
+			for (i = 0; i < BLOCK; i++)
+				ref[i] = rand ();
+			i = run (bch, ref, nerr);
+			if (i < 0)
+				detected++;
+			else if (i)
+				miscorrected++;
+		}
+		printf ("%2d errors: %5d detected, %5d miscorrected\n",
+			nerr, detected, miscorrected);
+		if (nerr <= t && (detected || miscorrected))
+			fail = 1;
+	}
+
+	gettimeofday (&t0, NULL);
+	for (r = 0; r < rounds; r++)
+		encode_bch (bch, ref, BLOCK, ecc);
+	gettimeofday (&t1, NULL);
+	us = (t1.tv_sec - t0.tv_sec) * 1e6 + (t1.tv_usec - t0.tv_usec);
+	if (us < 1)
+		us = 1;
+	printf ("encode: %8.1f MB/s\n", (double)BLOCK * rounds / us);
+
+	free_bch (bch);
+	printf ("%s\n", fail ? "FAILED" : "OK");
+	return fail;
+}
@@ -0,0 +1,112 @@
+/*
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * Check the word-wise NetCksum() of net/cksum.c against the plain
+ * halfword loop it replaced, on random buffers of random length and
+ * halfword alignment, including all-ones data that exercises the
+ * carry folding, and report the throughput of both.
+ *
+ * usage: cksum_test [rounds]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define MAXLEN	1600	/* bytes, a bit more than an Ethernet frame */
+
+/* net/cksum.c */
+extern unsigned NetCksum (unsigned char *ptr, int len);
+
+/* the original one's complement sum of len halfwords */
+static unsigned ref_cksum (unsigned char *ptr, int len)
+{
+	uint32_t xsum = 0;
+	uint16_t *p = (uint16_t *)ptr;
+
+	while (len-- > 0)
+		xsum += *p++;
+	xsum = (xsum & 0xffff) + (xsum >> 16);
+	xsum = (xsum & 0xffff) + (xsum >> 16);
+	return xsum & 0xffff;
+}
+
+typedef unsigned (*cksum_fn) (unsigned char *, int);
+
+static double bench (cksum_fn fn, unsigned char *buf, int rounds)
+{
+	struct timeval t0, t1;
+	volatile unsigned sink;
+	double us;
+	int r;
+
+	gettimeofday (&t0, NULL);
+	for (r = 0; r < rounds; r++)
+		sink = fn (buf, MAXLEN / 2);
+	gettimeofday (&t1, NULL);
+	(void)sink;
+	us = (t1.tv_sec - t0.tv_sec) * 1e6 + (t1.tv_usec - t0.tv_usec);
+	if (us < 1)
+		us = 1;
+	return (double)MAXLEN * rounds / us;
+}
+
+int main (int argc, char *argv[])
+{
+	static uint32_t space[(MAXLEN + 8) / 4];
+	unsigned char *buf = (unsigned char *)space;
+	int rounds = 100000, fail = 0, r, i, off, len;
+	unsigned a, b;
+
+	if (argc > 1)
+		rounds = strtol (argv[1], NULL, 0);
+	if (rounds <= 0) {
+		fprintf (stderr, "usage: %s [rounds]\n", argv[0]);
+		return 1;
+	}
+
+	srand (1);
+	for (r = 0; r < rounds && !fail; r++) {
+		/* every 16th buffer all ones, the worst case for carries */
+		for (i = 0; i < sizeof (space); i++)
+			buf[i] = r % 16 ? rand () : 0xff;
+		off = 2 * (rand () % 2);
+		len = rand () % (MAXLEN / 2 + 1);
+
+		a = ref_cksum (buf + off, len);
+		b = NetCksum (buf + off, len);
+		if (a != b) {
+			printf ("offset %d, %d halfwords: %04x, expected %04x\n",
+				off, len, b, a);
+			fail = 1;
+		}
+	}
+	printf ("%d buffers compared\n", r);
+
+	memset (buf, 0x5a, sizeof (space));
+	printf ("halfword loop: %8.1f MB/s\n", bench (ref_cksum, buf, rounds));
+	printf ("NetCksum:      %8.1f MB/s\n", bench (NetCksum, buf, rounds));
+
+	printf ("%s\n", fail ? "FAILED" : "OK");
+	return fail;
+}
@@ -0,0 +1,105 @@
+/*
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * Compare the byte-wise and the slicing-by-8 (CONFIG_CRC32_SLICE8)
+ * CRC32 of lib_generic/crc32.c: check that they agree and report the
+ * throughput of both on the build host.
+ *
+ * usage: crc32_bench [size in kB [rounds]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <sys/time.h>
+
+/* lib_generic/crc32.c, built once as is and once as crc32_slice8.o */
+extern uint32_t crc32 (uint32_t crc, const unsigned char *buf, unsigned int len);
+extern uint32_t crc32_s8 (uint32_t crc, const unsigned char *buf, unsigned int len);
+
+typedef uint32_t (*crc_fn) (uint32_t, const unsigned char *, unsigned int);
+
+static double bench (crc_fn fn, const unsigned char *buf, unsigned int len,
+		     int rounds, uint32_t *crc)
+{
+	struct timeval t0, t1;
+	double us;
+	int i;
+
+	gettimeofday (&t0, NULL);
+	for (i = 0; i < rounds; i++)
+		*crc = fn (0, buf, len);
+	gettimeofday (&t1, NULL);
+
+	us = (t1.tv_sec - t0.tv_sec) * 1e6 + (t1.tv_usec - t0.tv_usec);
+	if (us < 1)
+		us = 1;
+	return (double)len * rounds / us;	/* bytes/us == MB/s */
+}
+
+int main (int argc, char *argv[])
+{
+	unsigned int len = 1024, i;
+	int rounds = 64;
+	unsigned char *buf;
+	uint32_t c1, c8;
+	double mb1, mb8;
+
+	if (argc > 1)
+		len = strtoul (argv[1], NULL, 0);
+	if (argc > 2)
+		rounds = strtol (argv[2], NULL, 0);
+	if (len == 0 || rounds <= 0) {
+		fprintf (stderr, "usage: %s [size in kB [rounds]]\n", argv[0]);
+		return 1;
+	}
+	len *= 1024;
+
+	if ((buf = malloc (len + 8)) == NULL) {
+		perror ("malloc");
+		return 1;
+	}
+	srand (1);
+	for (i = 0; i < len + 8; i++)
+		buf[i] = rand ();
+
+	/* results must agree for any alignment and length */
+	for (i = 0; i < 8 * 64; i++) {
+		if (crc32 (i, buf + i % 8, i / 8) !=
+		    crc32_s8 (i, buf + i % 8, i / 8)) {
+			fprintf (stderr, "mismatch at offset %u length %u\n",
+				 i % 8, i / 8);
+			return 1;
+		}
+	}
+
+	mb1 = bench (crc32, buf, len, rounds, &c1);
+	mb8 = bench (crc32_s8, buf, len, rounds, &c8);
+	if (c1 != c8) {
+		fprintf (stderr, "mismatch: %08x != %08x\n", c1, c8);
+		return 1;
+	}
+
+	printf ("%u kB x %d: crc 0x%08x\n", len / 1024, rounds, c1);
+	printf ("byte-wise:     %8.1f MB/s\n", mb1);
+	printf ("slicing-by-8:  %8.1f MB/s  (x%.2f)\n", mb8, mb8 / mb1);
+	return 0;
+}
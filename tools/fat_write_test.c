@@ -0,0 +1,251 @@
+/*
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * Exercise the FAT write support of fs/fat/fat.c: create, replace and
+ * grow files of random sizes in the root directory until the disk is
+ * full, reading the files back every few writes.  A write may only fail
+ * for lack of space, and must leave the old contents of the file alone
+ * when it does.
+ *
+ * The volume is either a FAT12 or FAT16 image formatted here, or with
+ * -f an existing image, e.g. made by "mkfs.vfat [-F 32] -C image 65536".
+ * It is kept in memory and written to 'image' at the end (back to the
+ * same file with -f), so that it can be checked with
+ * "fsck.vfat -n image".
+ *
+ * Built by "make tests", not by default.
+ *
+ * usage: fat_write_test [fatsize [rounds [image]]]
+ *        fat_write_test -f image [rounds]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#define CONFIG_FAT_WRITE
+typedef unsigned char uchar;
+#include <part.h>
+#include <fat.h>
+
+#define SECT		512
+#define NFILES		16
+#define MAXFILE		(512 * 1024)
+
+static uint8_t *image;
+static unsigned long image_sects;
+
+static unsigned long
+img_read (int dev, unsigned long start, lbaint_t blkcnt, void *buffer)
+{
+	if (start + blkcnt > image_sects)
+		return 0;
+	memcpy (buffer, image + start * SECT, blkcnt * SECT);
+	return blkcnt;
+}
+
+static unsigned long
+img_write (int dev, unsigned long start, lbaint_t blkcnt, const void *buffer)
+{
+	if (start + blkcnt > image_sects)
+		return 0;
+	memcpy (image + start * SECT, buffer, blkcnt * SECT);
+	return blkcnt;
+}
+
+static void put16 (uint8_t *p, unsigned int v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+}
+
+/* Lay out an empty FAT12/16 volume, 2 FATs and 512 root entries */
+static void format (int fatsize)
+{
+	unsigned int clust_size = fatsize == 12 ? 2 : 1;
+	unsigned int rootdir = 512 * 32 / SECT, fatlength, clusters;
+	uint8_t *bs;
+
+	/* small enough for the files to fill it up */
+	image_sects = fatsize == 12 ? 2048 : 8192;
+	clusters = (image_sects - 1 - rootdir) / clust_size + 2;
+	fatlength = (clusters * fatsize / 8 + SECT) / SECT;
+
+	image = calloc (image_sects, SECT);
+	if (image == NULL) {
+		perror ("calloc");
+		exit (1);
+	}
+	bs = image;
+	memcpy (bs, "\xeb\x3c\x90" "MSWIN4.1", 11);
+	put16 (bs + 11, SECT);
+	bs[13] = clust_size;
+	put16 (bs + 14, 1);		/* reserved sectors */
+	bs[16] = 2;			/* FATs */
+	put16 (bs + 17, 512);		/* root directory entries */
+	put16 (bs + 19, image_sects);
+	bs[21] = 0xf8;			/* media */
+	put16 (bs + 22, fatlength);
+	put16 (bs + 24, 32);		/* sectors per track */
+	put16 (bs + 26, 64);		/* heads */
+	bs[36] = 0x80;			/* drive number */
+	bs[38] = 0x29;			/* extended boot signature */
+	memcpy (bs + 43, "NO NAME    ", 11);
+	memcpy (bs + 54, fatsize == 12 ? "FAT12   " : "FAT16   ", 8);
+	bs[510] = 0x55;
+	bs[511] = 0xaa;
+
+	/* media descriptor and end of chain in entries 0 and 1 */
+	memset (image + SECT, 0xff, fatsize == 12 ? 3 : 4);
+	image[SECT] = 0xf8;
+	memcpy (image + (1 + fatlength) * SECT, image + SECT, 4);
+
+	printf ("FAT%d: %lu sectors, %u clusters of %u bytes\n",
+		fatsize, image_sects, clusters - 2, clust_size * SECT);
+}
+
+/* Read an existing image into memory */
+static void load (const char *name)
+{
+	FILE *fp;
+	long len;
+
+	fp = fopen (name, "rb");
+	if (fp == NULL || fseek (fp, 0, SEEK_END) != 0 ||
+	    (len = ftell (fp)) < SECT || fseek (fp, 0, SEEK_SET) != 0) {
+		perror (name);
+		exit (1);
+	}
+	image_sects = len / SECT;
+	image = malloc (image_sects * SECT);
+	if (image == NULL) {
+		perror ("malloc");
+		exit (1);
+	}
+	if (fread (image, SECT, image_sects, fp) != image_sects) {
+		perror (name);
+		exit (1);
+	}
+	fclose (fp);
+
+	printf ("%s: %lu sectors\n", name, image_sects);
+}
+
+int main (int argc, char *argv[])
+{
+	static uint8_t ref[NFILES][MAXFILE], buf[MAXFILE + SECT];
+	static long size[NFILES];
+	block_dev_desc_t dev;
+	char name[16], *out = NULL;
+	int fatsize = 16, rounds = 500, fail = 0, full = 0;
+	int r, f, i;
+	long n, len;
+	FILE *fp;
+
+	if (argc > 2 && !strcmp (argv[1], "-f")) {
+		/* an existing image, written back at the end */
+		out = argv[2];
+		fatsize = 0;
+		if (argc > 3)
+			rounds = strtol (argv[3], NULL, 0);
+	} else {
+		if (argc > 1)
+			fatsize = strtol (argv[1], NULL, 0);
+		if (argc > 2)
+			rounds = strtol (argv[2], NULL, 0);
+		if (argc > 3)
+			out = argv[3];
+	}
+	if ((fatsize != 0 && fatsize != 12 && fatsize != 16) || rounds <= 0) {
+		fprintf (stderr, "usage: %s [fatsize (12|16) [rounds [image]]]\n"
+			 "       %s -f image [rounds]\n", argv[0], argv[0]);
+		return 1;
+	}
+	if (fatsize)
+		format (fatsize);
+	else
+		load (out);
+
+	memset (&dev, 0, sizeof (dev));
+	dev.blksz = SECT;
+	dev.lba = image_sects;
+	dev.block_read = img_read;
+	dev.block_write = img_write;
+	if (fat_register_device (&dev, 1) != 0 || file_fat_detectfs () != 0) {
+		fprintf (stderr, "no FAT file system found\n");
+		return 1;
+	}
+
+	for (f = 0; f < NFILES; f++)
+		size[f] = -1;
+
+	srand (1);
+	for (r = 0; r < rounds && !fail; r++) {
+		f = rand () % NFILES;
+		/* mostly small files, now and then a big one */
+		len = rand () % 4 ? rand () % 16384 : rand () % MAXFILE;
+		for (i = 0; i < len; i++)
+			buf[i] = rand ();
+		sprintf (name, "/FILE%d.BIN", f);
+
+		n = file_fat_write (name, buf, len);
+		if (n == len) {
+			memcpy (ref[f], buf, len);
+			size[f] = len;
+		} else {
+			/* only a full disk is an excuse */
+			full++;
+		}
+
+		/* check all files now and then, and at the end */
+		for (f = 0; f < NFILES; f++) {
+			if (size[f] < 0 || (r % 16 && r != rounds - 1))
+				continue;
+			sprintf (name, "/FILE%d.BIN", f);
+			memset (buf, 0, sizeof (buf));
+			n = file_fat_read (name, buf, sizeof (buf));
+			if (n != size[f] || memcmp (buf, ref[f], n)) {
+				printf ("round %d: %s read back %ld of %ld "
+					"bytes, %s\n", r, name, n, size[f],
+					n == size[f] ? "data differs" :
+						       "size differs");
+				fail = 1;
+			}
+		}
+	}
+	printf ("%d rounds, %d writes refused\n", r, full);
+
+	if (out != NULL) {
+		fp = fopen (out, "wb");
+		if (fp == NULL ||
+		    fwrite (image, SECT, image_sects, fp) != image_sects ||
+		    fclose (fp) != 0) {
+			perror (out);
+			fail = 1;
+		}
+	}
+
+	free (image);
+	printf ("%s\n", fail ? "FAILED" : "OK");
+	return fail;
+}
@@ -0,0 +1,249 @@
+/*
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * Check the word-parallel Hamming ECC of drivers/mtd/nand/nand_ecc.c
+ * against the table driven code it replaced, for 256 byte steps
+ * (NAND_ECC_SOFT) and 512 byte steps (NAND_ECC_SOFT_512): the ECC of
+ * random, sparse and misaligned data must match, every single bit
+ * error in data or ECC must be corrected and double bit errors in the
+ * data must be reported.  The throughput of both is printed as well.
+ *
+ * usage: nand_ecc_test [rounds]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/types.h>
+
+typedef uint16_t u16;
+#include <linux/mtd/mtd.h>
+#include <linux/mtd/nand.h>
+
+/* drivers/mtd/nand/nand_ecc.c */
+extern int nand_calculate_ecc (struct mtd_info *mtd, const u_char *dat,
+			       u_char *ecc_code);
+extern int nand_correct_data (struct mtd_info *mtd, u_char *dat,
+			      u_char *read_ecc, u_char *calc_ecc);
+
+/* Pre-calculated 256-way 1 byte column parity, as in the old code */
+static const u_char precalc_table[] = {
+	0x00, 0x55, 0x56, 0x03, 0x59, 0x0c, 0x0f, 0x5a, 0x5a, 0x0f, 0x0c, 0x59, 0x03, 0x56, 0x55, 0x00,
+	0x65, 0x30, 0x33, 0x66, 0x3c, 0x69, 0x6a, 0x3f, 0x3f, 0x6a, 0x69, 0x3c, 0x66, 0x33, 0x30, 0x65,
+	0x66, 0x33, 0x30, 0x65, 0x3f, 0x6a, 0x69, 0x3c, 0x3c, 0x69, 0x6a, 0x3f, 0x65, 0x30, 0x33, 0x66,
+	0x03, 0x56, 0x55, 0x00, 0x5a, 0x0f, 0x0c, 0x59, 0x59, 0x0c, 0x0f, 0x5a, 0x00, 0x55, 0x56, 0x03,
+	0x69, 0x3c, 0x3f, 0x6a, 0x30, 0x65, 0x66, 0x33, 0x33, 0x66, 0x65, 0x30, 0x6a, 0x3f, 0x3c, 0x69,
+	0x0c, 0x59, 0x5a, 0x0f, 0x55, 0x00, 0x03, 0x56, 0x56, 0x03, 0x00, 0x55, 0x0f, 0x5a, 0x59, 0x0c,
+	0x0f, 0x5a, 0x59, 0x0c, 0x56, 0x03, 0x00, 0x55, 0x55, 0x00, 0x03, 0x56, 0x0c, 0x59, 0x5a, 0x0f,
+	0x6a, 0x3f, 0x3c, 0x69, 0x33, 0x66, 0x65, 0x30, 0x30, 0x65, 0x66, 0x33, 0x69, 0x3c, 0x3f, 0x6a,
+	0x6a, 0x3f, 0x3c, 0x69, 0x33, 0x66, 0x65, 0x30, 0x30, 0x65, 0x66, 0x33, 0x69, 0x3c, 0x3f, 0x6a,
+	0x0f, 0x5a, 0x59, 0x0c, 0x56, 0x03, 0x00, 0x55, 0x55, 0x00, 0x03, 0x56, 0x0c, 0x59, 0x5a, 0x0f,
+	0x0c, 0x59, 0x5a, 0x0f, 0x55, 0x00, 0x03, 0x56, 0x56, 0x03, 0x00, 0x55, 0x0f, 0x5a, 0x59, 0x0c,
+	0x69, 0x3c, 0x3f, 0x6a, 0x30, 0x65, 0x66, 0x33, 0x33, 0x66, 0x65, 0x30, 0x6a, 0x3f, 0x3c, 0x69,
+	0x03, 0x56, 0x55, 0x00, 0x5a, 0x0f, 0x0c, 0x59, 0x59, 0x0c, 0x0f, 0x5a, 0x00, 0x55, 0x56, 0x03,
+	0x66, 0x33, 0x30, 0x65, 0x3f, 0x6a, 0x69, 0x3c, 0x3c, 0x69, 0x6a, 0x3f, 0x65, 0x30, 0x33, 0x66,
+	0x65, 0x30, 0x33, 0x66, 0x3c, 0x69, 0x6a, 0x3f, 0x3f, 0x6a, 0x69, 0x3c, 0x66, 0x33, 0x30, 0x65,
+	0x00, 0x55, 0x56, 0x03, 0x59, 0x0c, 0x0f, 0x5a, 0x5a, 0x0f, 0x0c, 0x59, 0x03, 0x56, 0x55, 0x00
+};
+
+/*
+ * The old table driven nand_calculate_ecc(), extended to 512 bytes the
+ * obvious way: the line parity of byte offset bit 8 goes to the two low
+ * bits of the third byte, which stay ones for 256 bytes.
+ */
+static void old_calculate_ecc (const u_char *dat, int len, u_char *ecc_code)
+{
+	uint8_t idx, reg1, tmp1, tmp2;
+	uint16_t reg2, reg3;
+	int i;
+
+	reg1 = reg2 = reg3 = 0;
+	for (i = 0; i < len; i++) {
+		idx = precalc_table[*dat++];
+		reg1 ^= (idx & 0x3f);
+		if (idx & 0x40) {
+			reg3 ^= (uint16_t) i;
+			reg2 ^= ~((uint16_t) i);
+		}
+	}
+
+	tmp1  = (reg3 & 0x80) >> 0;
+	tmp1 |= (reg2 & 0x80) >> 1;
+	tmp1 |= (reg3 & 0x40) >> 1;
+	tmp1 |= (reg2 & 0x40) >> 2;
+	tmp1 |= (reg3 & 0x20) >> 2;
+	tmp1 |= (reg2 & 0x20) >> 3;
+	tmp1 |= (reg3 & 0x10) >> 3;
+	tmp1 |= (reg2 & 0x10) >> 4;
+
+	tmp2  = (reg3 & 0x08) << 4;
+	tmp2 |= (reg2 & 0x08) << 3;
+	tmp2 |= (reg3 & 0x04) << 3;
+	tmp2 |= (reg2 & 0x04) << 2;
+	tmp2 |= (reg3 & 0x02) << 2;
+	tmp2 |= (reg2 & 0x02) << 1;
+	tmp2 |= (reg3 & 0x01) << 1;
+	tmp2 |= (reg2 & 0x01) << 0;
+
+	ecc_code[0] = ~tmp1;
+	ecc_code[1] = ~tmp2;
+	ecc_code[2] = ((~reg1) << 2) | 0x03;
+	if (len == 512)
+		ecc_code[2] &= ~((((reg3 >> 8) & 1) << 1) |
+				 ((reg2 >> 8) & 1));
+}
+
+static double bench (struct mtd_info *mtd, const u_char *dat, int len,
+		     int rounds, int old)
+{
+	struct timeval t0, t1;
+	u_char ecc[3];
+	double us;
+	int r;
+
+	gettimeofday (&t0, NULL);
+	for (r = 0; r < rounds; r++) {
+		if (old)
+			old_calculate_ecc (dat, len, ecc);
+		else
+			nand_calculate_ecc (mtd, dat, ecc);
+	}
+	gettimeofday (&t1, NULL);
+	us = (t1.tv_sec - t0.tv_sec) * 1e6 + (t1.tv_usec - t0.tv_usec);
+	if (us < 1)
+		us = 1;
+	return (double)len * rounds / us;
+}
+
+/* One step size: returns the number of failures */
+static int check (struct mtd_info *mtd, int len, int rounds)
+{
+	static uint32_t space[(512 + 8) / 4];
+	u_char *buf = (u_char *)space, *dat, save[512];
+	u_char ref[3], ecc[3], calc[3], bad[3];
+	int fail = 0, r, i, bit, b2, ret;
+
+	for (r = 0; r < rounds; r++) {
+		/* random, sparse (erased page with a few bits) and zero data */
+		dat = buf + r % 8;
+		for (i = 0; i < len; i++) {
+			switch (r % 3) {
+			case 0:
+				dat[i] = rand ();
+				break;
+			case 1:
+				dat[i] = rand () % 64 ? 0xff : rand ();
+				break;
+			default:
+				dat[i] = rand () % 64 ? 0 : 1 << (rand () % 8);
+				break;
+			}
+		}
+
+		old_calculate_ecc (dat, len, ref);
+		nand_calculate_ecc (mtd, dat, ecc);
+		if (memcmp (ref, ecc, 3)) {
+			printf ("%d: ECC %02x%02x%02x, expected %02x%02x%02x\n",
+				len, ecc[0], ecc[1], ecc[2],
+				ref[0], ref[1], ref[2]);
+			fail++;
+			continue;
+		}
+
+		/* a single bit error in the data */
+		memcpy (save, dat, len);
+		bit = rand () % (len * 8);
+		dat[bit / 8] ^= 1 << (bit % 8);
+		nand_calculate_ecc (mtd, dat, calc);
+		ret = nand_correct_data (mtd, dat, ecc, calc);
+		if (ret != 1 || memcmp (dat, save, len)) {
+			printf ("%d: data bit %d not corrected (%d)\n",
+				len, bit, ret);
+			fail++;
+			memcpy (dat, save, len);
+		}
+
+		/* a single bit error in the ECC; two spare bits at 256 */
+		do
+			bit = rand () % 24;
+		while (len == 256 && (bit == 16 || bit == 17));
+		memcpy (bad, ecc, 3);
+		bad[bit / 8] ^= 1 << (bit % 8);
+		ret = nand_correct_data (mtd, dat, bad, ecc);
+		if (ret != 1 || memcmp (dat, save, len)) {
+			printf ("%d: ECC bit %d not accepted (%d)\n",
+				len, bit, ret);
+			fail++;
+			memcpy (dat, save, len);
+		}
+
+		/* two bit errors in the data */
+		bit = rand () % (len * 8);
+		do
+			b2 = rand () % (len * 8);
+		while (b2 == bit);
+		dat[bit / 8] ^= 1 << (bit % 8);
+		dat[b2 / 8] ^= 1 << (b2 % 8);
+		nand_calculate_ecc (mtd, dat, calc);
+		ret = nand_correct_data (mtd, dat, ecc, calc);
+		if (ret != -1) {
+			printf ("%d: data bits %d and %d not detected (%d)\n",
+				len, bit, b2, ret);
+			fail++;
+		}
+	}
+	printf ("%d byte steps: %d blocks, %d failures\n", len, r, fail);
+
+	printf ("  table:         %8.1f MB/s\n",
+		bench (mtd, buf, len, rounds, 1));
+	printf ("  nand_ecc.c:    %8.1f MB/s\n",
+		bench (mtd, buf, len, rounds, 0));
+	return fail;
+}
+
+int main (int argc, char *argv[])
+{
+	struct nand_chip chip;
+	struct mtd_info mtd;
+	int rounds = 100000, fail;
+
+	if (argc > 1)
+		rounds = strtol (argv[1], NULL, 0);
+	if (rounds <= 0) {
+		fprintf (stderr, "usage: %s [rounds]\n", argv[0]);
+		return 1;
+	}
+
+	memset (&chip, 0, sizeof (chip));
+	memset (&mtd, 0, sizeof (mtd));
+	mtd.priv = &chip;
+
+	srand (1);
+	chip.eccmode = NAND_ECC_SOFT;
+	fail = check (&mtd, 256, rounds);
+	chip.eccmode = NAND_ECC_SOFT_512;
+	fail += check (&mtd, 512, rounds);
+
+	printf ("%s\n", fail ? "FAILED" : "OK");
+	return fail != 0;
+}